@@ -0,0 +1,226 @@
+#include "board.h"
+#include "kernels.h"
+#include "lineio.h"
+#include "pipeline.h"
+#include "scheduler.h"
+#include "search.h"
+#include "solver.h"
+#include "subsets.h"
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using ordered_json = nlohmann::ordered_json;
+
+struct Tier {
+  std::string name;
+  std::string path;
+  std::vector<Board> boards;
+};
+
+static volatile uint64_t sink;
+
+static bool loadTier( Tier &tier ) {
+  if ( isJsonPath( tier.path ) ) {
+    std::ifstream in( tier.path );
+    if ( !in )
+      return false;
+    for ( const json &board : json::parse( in ) ) {
+      tier.boards.push_back( boardFromJson<3>( board.at( "value" ) ) );
+    }
+    return true;
+  }
+
+  MappedFile file;
+  if ( !file.open( tier.path ) )
+    return false;
+  size_t offset = 0;
+  while ( offset < file.size() ) {
+    const char *line = file.data() + offset;
+    size_t length = nextLine( file.data(), file.size(), offset );
+    Board board;
+    if ( parseLineBoard( line, length, board ) )
+      tier.boards.push_back( board );
+  }
+  return true;
+}
+
+// naked and hidden singles until neither finds anything, i.e. the state the other techniques start from
+static void applySingles( Board &board ) {
+  PlacementList<3> singles;
+  while ( 1 ) {
+    findAllNakedSingles( board, singles );
+    if ( singles.count == 0 )
+      findAllHiddenSingles( board, singles );
+    if ( singles.count == 0 )
+      return;
+    for ( int i = 0; i < singles.count; i++ ) {
+      placeValue( board, singles.items[ i ].num, singles.items[ i ].cell );
+    }
+  }
+}
+
+// runs op on a fresh copy of every state, over and over for at least minSeconds
+static double nsPerOp( const std::vector<Board> &states, double minSeconds,
+                       const std::function<uint64_t( Board & )> &op ) {
+  if ( states.empty() )
+    return 0.0;
+  uint64_t ops = 0, checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  double elapsed = 0.0;
+  do {
+    for ( const Board &state : states ) {
+      Board board = state;
+      checksum += op( board );
+    }
+    ops += states.size();
+    elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+  } while ( elapsed < minSeconds );
+  sink = checksum;
+  return elapsed * 1e9 / ops;
+}
+
+static ordered_json benchTechniques( const std::vector<Board> &initial, const std::vector<Board> &stalled,
+                                     double minSeconds ) {
+  ordered_json results;
+  auto add = [ & ]( const char *name, const std::vector<Board> &states, const std::function<uint64_t( Board & )> &op ) {
+    results[ name ] = { { "states", states.size() }, { "ns_per_op", nsPerOp( states, minSeconds, op ) } };
+  };
+
+  PlacementList<3> singles;
+  add( "boardCopy", initial, []( Board &board ) { return board.values[ 0 ]; } );
+  add( "findAllNakedSingles", initial, [ & ]( Board &board ) {
+    findAllNakedSingles( board, singles );
+    return singles.count;
+  } );
+  add( "findAllHiddenSingles", initial, [ & ]( Board &board ) {
+    findAllHiddenSingles( board, singles );
+    return singles.count;
+  } );
+  add( "applyPointingPairs", stalled, []( Board &board ) { return applyPointingPairs( board ); } );
+  add( "reduceBoxLine", stalled, []( Board &board ) { return reduceBoxLine( board ); } );
+  add( "nakedSubsets", stalled, []( Board &board ) { return nakedSubsets( board ); } );
+  add( "hiddenSubsets", stalled, []( Board &board ) { return hiddenSubsets( board ); } );
+  add( "xyWing", stalled, []( Board &board ) { return xyWing( board ); } );
+  add( "xyzWing", stalled, []( Board &board ) { return xyzWing( board ); } );
+  add( "xWing", stalled, []( Board &board ) { return xWing( board ); } );
+  add( "swordfish", stalled, []( Board &board ) { return swordfish( board ); } );
+  add( "jellyfish", stalled, []( Board &board ) { return jellyfish( board ); } );
+  add( "finnedFish", stalled, []( Board &board ) { return finnedFish( board ); } );
+  add( "searchSolve", stalled, []( Board &board ) { return searchSolve( board ); } );
+  return results;
+}
+
+// logical( board ) steps as far as it can, search( board ) finishes what it left
+template <typename Logical, typename Search>
+static ordered_json benchTier( const Tier &tier, double minSeconds, Logical &&logical, Search &&search ) {
+  uint64_t solved = 0, searched = 0, passes = 0;
+  auto start = std::chrono::steady_clock::now();
+  double elapsed = 0.0;
+  do {
+    for ( const Board &puzzle : tier.boards ) {
+      Board board = puzzle;
+      bool stepped = logical( board );
+      solved += stepped || search( board );
+      searched += !stepped;
+    }
+    passes++;
+    elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+  } while ( elapsed < minSeconds && !tier.boards.empty() );
+
+  uint64_t total = passes * tier.boards.size();
+  return { { "path", tier.path },
+           { "puzzles", tier.boards.size() },
+           { "solved", passes ? solved / passes : 0 },
+           { "searched", passes ? searched / passes : 0 },
+           { "ns_per_puzzle", total ? elapsed * 1e9 / total : 0.0 },
+           { "puzzles_per_sec", elapsed > 0 ? total / elapsed : 0.0 } };
+}
+
+static int usage() {
+  std::cerr << "usage: sudoku-bench [--corpus name=file]... [--min-time seconds] [--output file]" << std::endl;
+  return 2;
+}
+
+int main( int argc, char **argv ) {
+  std::vector<Tier> tiers;
+  double minSeconds = 0.5;
+  std::string outputPath = "-";
+  for ( int i = 1; i < argc; i++ ) {
+    std::string arg = argv[ i ];
+    if ( arg == "--corpus" && i + 1 < argc ) {
+      std::string spec = argv[ ++i ];
+      size_t split = spec.find( '=' );
+      if ( split == std::string::npos )
+        return usage();
+      tiers.push_back( { spec.substr( 0, split ), spec.substr( split + 1 ), {} } );
+    } else if ( arg == "--min-time" && i + 1 < argc ) {
+      minSeconds = std::stod( argv[ ++i ] );
+    } else if ( arg == "--output" && i + 1 < argc ) {
+      outputPath = argv[ ++i ];
+    } else {
+      return usage();
+    }
+  }
+  if ( tiers.empty() ) {
+    tiers = {
+        { "medium", "boards.json", {} },
+        { "17clue", "bench/corpus/17clue.txt", {} },
+        { "hard", "bench/corpus/hard.txt", {} },
+    };
+  }
+
+  std::vector<Board> initial, stalled;
+  for ( Tier &tier : tiers ) {
+    if ( !loadTier( tier ) ) {
+      std::cerr << "failed to load " << tier.path << std::endl;
+      return 1;
+    }
+    for ( const Board &board : tier.boards ) {
+      initial.push_back( board );
+      Board state = board;
+      applySingles( state );
+      if ( !isSolved( state ) )
+        stalled.push_back( state );
+    }
+  }
+
+  ordered_json report;
+  report[ "kernels" ] = kernelName();
+  report[ "min_seconds" ] = minSeconds;
+  report[ "techniques" ] = benchTechniques( initial, stalled, minSeconds );
+  // "tiers" is the full ladder, as solveLogically runs it; "pipelines" has every preset. The
+  // adaptive one starts each tier from scratch and learns as it goes.
+  for ( int preset = 0; preset < PIPELINE_COUNT; preset++ ) {
+    for ( const Tier &tier : tiers ) {
+      ordered_json result;
+      if ( preset == ADAPTIVE_PIPELINE ) {
+        AdaptiveScheduler<3> scheduler;
+        result = benchTier(
+            tier, minSeconds, [ & ]( Board &board ) { return scheduler.solveLogically( board ); },
+            [ & ]( Board &board ) { return scheduler.searchFallback( board ); } );
+      } else {
+        result = withPipeline( preset, [ & ]( auto pipeline ) {
+          return benchTier(
+              tier, minSeconds, []( Board &board ) { return decltype( pipeline )::solve( board ); },
+              []( Board &board ) { return searchSolve( board ); } );
+        } );
+      }
+      if ( preset == HUMAN_PIPELINE )
+        report[ "tiers" ][ tier.name ] = result;
+      report[ "pipelines" ][ pipelineName( preset ) ][ tier.name ] = result;
+    }
+  }
+
+  std::string text = report.dump( 2 ) + "\n";
+  if ( outputPath == "-" ) {
+    std::cout << text;
+  } else {
+    std::ofstream out( outputPath );
+    out << text;
+  }
+  return 0;
+}
@@ -0,0 +1,626 @@
+#include "batch.h"
+#include "board.h"
+#include "corpus.h"
+#include "histogram.h"
+#include "kernels.h"
+#include "lanes.h"
+#include "lineio.h"
+#include "pipeline.h"
+#include "pool.h"
+#include "scheduler.h"
+#include "search.h"
+#include "solver.h"
+#include "stats.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// small enough that a run of hard boards in one chunk is quickly stolen around
+#define BATCH_GRAIN 64
+// 9x9 boards parsed per round in the streaming path, larger boards get proportionally fewer
+#define BATCH_BLOCK 16384
+// boards a worker puts through the lanes before it trusts their hit rate, and after which
+// what it learned so far counts half
+#define LANES_WINDOW 1024
+// while the lanes leave most boards to the cascade, only every this many chunks go through them
+#define LANES_RETRY 16
+
+template <int N> struct Puzzle {
+  BasicBoard<N> board;
+  BasicBoard<N> solution;
+  bool hasSolution;
+  SolveTrace trace;
+  Grade grade;
+};
+
+struct BatchOptions {
+  std::string outputPath;
+  std::string statsPath;
+  std::string tracePath;
+  std::string gradePath;
+  bool perf = false;
+  bool lanes = false;
+  // per-puzzle limits, none when 0
+  std::chrono::microseconds timeLimit { 0 };
+  uint64_t stepLimit = 0;
+  // not owned; with one, 16x16 and 25x25 searches are split over it
+  ThreadPool *speculation = nullptr;
+  int pipeline = HUMAN_PIPELINE;
+};
+
+enum SolveStatus { SOLVED, STALLED, INCORRECT };
+
+// one per worker so the counters are never shared between threads
+struct alignas( 64 ) WorkerTotals {
+  size_t counts[ 3 ] = { 0, 0, 0 };
+  size_t searched = 0;
+  size_t stopped[ STOP_REASON_COUNT ] = {};  // only the budget reasons are counted
+  size_t difficulties[ DIFFICULTY_COUNT ] = {};
+  LatencyHistogram latencies;
+  // --lanes: boards put through the lanes, how many they finished, chunks run scalar since
+  uint64_t laneBoards = 0, laneSolved = 0, scalarChunks = 0;
+  SolveStats stats;
+  // opened lazily on the worker's own thread, since perf counts the thread that opens it
+  std::unique_ptr<PerfCounters> perf;
+};
+
+template <int N> static bool isCorrect( const BasicBoard<N> &board, const Puzzle<N> &puzzle ) {
+  using B = BasicBoard<N>;
+  if ( puzzle.hasSolution )
+    return std::memcmp( board.values, puzzle.solution.values, B::CELL_COUNT ) == 0;
+
+  // no reference solution, so check that every unit holds each digit once
+  for ( const auto &cells : boardTables<N>.unitCells ) {
+    uint32_t seen = 0;
+    for ( int i = 0; i < B::GRID_SIZE; i++ ) {
+      seen |= digitBit( board.values[ cells[ i ] ] );
+    }
+    if ( seen != B::ALL_CANDIDATES )
+      return false;
+  }
+  return true;
+}
+
+template <int N> static std::vector<Puzzle<N>> loadPuzzles( const json &boards ) {
+  std::vector<Puzzle<N>> puzzles;
+  puzzles.reserve( boards.size() );
+  for ( const json &board : boards ) {
+    Puzzle<N> puzzle = {};
+    puzzle.board = boardFromJson<N>( board.at( "value" ) );
+    puzzle.hasSolution = board.contains( "solution" );
+    if ( puzzle.hasSolution )
+      puzzle.solution = boardFromJson<N>( board.at( "solution" ) );
+    puzzles.push_back( puzzle );
+  }
+  return puzzles;
+}
+
+// the cascade and then search, under the per-puzzle limits when there are any; a puzzle
+// that runs out is left as far as it got and counted as stalled
+template <int N>
+static bool solvePuzzle( BasicBoard<N> &board, const BatchOptions &options, SolveStats *stats, SolveTrace *trace,
+                         WorkerTotals &totals ) {
+  SolveBudget budget;
+  SolveBudget *limits = nullptr;
+  if ( options.timeLimit.count() > 0 || options.stepLimit > 0 ) {
+    if ( options.timeLimit.count() > 0 )
+      budget.setTimeLimit( options.timeLimit );
+    if ( options.stepLimit > 0 )
+      budget.setStepLimit( options.stepLimit );
+    limits = &budget;
+  }
+  bool logical, solved;
+  // a puzzle whose budget ran out in the techniques never reaches search
+  bool stoppedBeforeSearch = false;
+  if ( options.pipeline == ADAPTIVE_PIPELINE ) {
+    // one per worker thread, learning from every puzzle that worker solves
+    thread_local AdaptiveScheduler<N> scheduler;
+    logical = scheduler.solveLogically( board, stats, trace, limits );
+    stoppedBeforeSearch = budget.isExhausted();
+    solved = logical ||
+             ( !budget.isExhausted() && scheduler.searchFallback( board, stats, trace, limits, options.speculation ) );
+  } else {
+    logical = withPipeline( options.pipeline, [ & ]( auto steps ) {
+      return decltype( steps )::solve( board, stats, trace, limits );
+    } );
+    stoppedBeforeSearch = budget.isExhausted();
+    solved = logical || ( !budget.isExhausted() && searchFallback( board, stats, trace, limits, options.speculation ) );
+  }
+  totals.searched += !logical && !stoppedBeforeSearch;
+  if ( budget.isExhausted() )
+    totals.stopped[ budget.reason() ]++;
+  return solved;
+}
+
+// 9x9 only: singles for the whole chunk in SIMD lanes, then the scalar cascade for the
+// boards they didn't finish. A lane-solved board's latency is its share of the lane time.
+static void solveChunkInLanes( std::vector<Puzzle<3>> &puzzles, size_t begin, size_t end, const BatchOptions &options,
+                               WorkerTotals &totals ) {
+  Board *boards[ BATCH_GRAIN ];
+  bool solved[ BATCH_GRAIN ] = {};
+  size_t count = end - begin;
+  for ( size_t i = 0; i < count; i++ ) {
+    boards[ i ] = &puzzles[ begin + i ].board;
+  }
+  auto start = std::chrono::steady_clock::now();
+  solveSinglesInLanes( boards, count, solved );
+  auto stop = std::chrono::steady_clock::now();
+  uint64_t share = std::chrono::duration_cast<std::chrono::nanoseconds>( stop - start ).count() / count;
+  totals.laneBoards += count;
+  totals.laneSolved += std::count( solved, solved + count, true );
+  if ( totals.laneBoards >= 2 * LANES_WINDOW ) {
+    totals.laneBoards /= 2;
+    totals.laneSolved /= 2;
+  }
+
+  for ( size_t i = 0; i < count; i++ ) {
+    Puzzle<3> &puzzle = puzzles[ begin + i ];
+    bool finished = solved[ i ];
+    uint64_t ns = share;
+    if ( !finished ) {
+      start = std::chrono::steady_clock::now();
+      finished = solvePuzzle( puzzle.board, options, nullptr, nullptr, totals );
+      stop = std::chrono::steady_clock::now();
+      ns += std::chrono::duration_cast<std::chrono::nanoseconds>( stop - start ).count();
+    }
+    totals.latencies.record( ns );
+    totals.counts[ !finished ? STALLED : isCorrect( puzzle.board, puzzle ) ? SOLVED : INCORRECT ]++;
+  }
+}
+
+// The lanes only pay off while singles finish most boards: every board they leave goes
+// through the cascade just the same. A worker whose recent boards mostly got past them
+// runs its chunks scalar, and tries the lanes again every LANES_RETRY chunks in case the
+// input has changed.
+static bool lanesPayOff( WorkerTotals &totals ) {
+  if ( totals.laneBoards < LANES_WINDOW || 2 * totals.laneSolved >= totals.laneBoards )
+    return true;
+  return ++totals.scalarChunks % LANES_RETRY == 0;
+}
+
+// solves puzzles[ 0, count ) in place
+template <int N>
+static void solveBlock( ThreadPool &pool, std::vector<Puzzle<N>> &puzzles, size_t count,
+                        std::vector<WorkerTotals> &workers, const BatchOptions &options ) {
+  bool collectStats = !options.statsPath.empty();
+  bool grade = !options.gradePath.empty();
+  // grades are read off the trace
+  bool collectTraces = grade || !options.tracePath.empty();
+  pool.parallelFor( count, BATCH_GRAIN, [ & ]( size_t begin, size_t end, unsigned worker ) {
+    WorkerTotals &totals = workers[ worker ];
+    if ( options.perf && collectStats && !totals.perf ) {
+      totals.perf = std::make_unique<PerfCounters>();
+      if ( totals.perf->open() )
+        totals.stats.perf = totals.perf.get();
+    }
+    // the lanes don't count steps, so they're only used when nothing per step is asked for
+    if constexpr ( N == 3 ) {
+      if ( options.lanes && !collectStats && !collectTraces && lanesPayOff( totals ) ) {
+        solveChunkInLanes( puzzles, begin, end, options, totals );
+        return;
+      }
+    }
+    SolveStats *stats = collectStats ? &totals.stats : nullptr;
+    for ( size_t i = begin; i < end; i++ ) {
+      Puzzle<N> &puzzle = puzzles[ i ];
+      SolveTrace *trace = nullptr;
+      if ( collectTraces ) {
+        puzzle.trace.clear();
+        trace = &puzzle.trace;
+      }
+      auto start = std::chrono::steady_clock::now();
+      bool solved = solvePuzzle( puzzle.board, options, stats, trace, totals );
+      auto stop = std::chrono::steady_clock::now();
+
+      totals.latencies.record( std::chrono::duration_cast<std::chrono::nanoseconds>( stop - start ).count() );
+      totals.counts[ !solved ? STALLED : isCorrect( puzzle.board, puzzle ) ? SOLVED : INCORRECT ]++;
+      if ( grade ) {
+        puzzle.grade = gradeTrace( puzzle.trace );
+        totals.difficulties[ puzzle.grade.difficulty ]++;
+      }
+    }
+  } );
+}
+
+// traces go out as a JSON array of strings, one technique code per step
+template <int N>
+static void writeTraces( BufferedWriter &out, const std::vector<Puzzle<N>> &puzzles, size_t count, bool &first ) {
+  for ( size_t i = 0; i < count; i++ ) {
+    const SolveTrace &trace = puzzles[ i ].trace;
+    out.write( first ? "[\n  \"" : ",\n  \"", 5 );
+    first = false;
+    for ( uint8_t technique : trace ) {
+      out.put( techniqueCode( technique ) );
+    }
+    out.put( '"' );
+  }
+}
+
+// Grades go out as a JSON array of objects for a .json path and as CSV with a header
+// otherwise, either way one entry per puzzle in input order.
+template <int N>
+static void writeGrades( BufferedWriter &out, const std::vector<Puzzle<N>> &puzzles, size_t count, bool asJson,
+                         bool &first ) {
+  std::string text;
+  if ( first && !asJson ) {
+    text = "score,difficulty,hardest,steps";
+    for ( int technique = 0; technique < TECHNIQUE_COUNT; technique++ ) {
+      text += ',';
+      text += techniqueName( technique );
+    }
+    text += '\n';
+  }
+  for ( size_t i = 0; i < count; i++ ) {
+    const Grade &grade = puzzles[ i ].grade;
+    const char *hardest = techniqueName( grade.hardest );
+    if ( asJson ) {
+      nlohmann::ordered_json counts;
+      for ( int technique = 0; technique < TECHNIQUE_COUNT; technique++ ) {
+        counts[ techniqueName( technique ) ] = grade.counts[ technique ];
+      }
+      nlohmann::ordered_json entry = { { "score", grade.score },
+                                       { "difficulty", difficultyName( grade.difficulty ) },
+                                       { "hardest", hardest },
+                                       { "steps", puzzles[ i ].trace.size() },
+                                       { "counts", counts } };
+      text += first ? "[\n  " : ",\n  ";
+      text += entry.dump();
+    } else {
+      text += std::to_string( grade.score ) + ',' + difficultyName( grade.difficulty ) + ',' + hardest + ',' +
+              std::to_string( puzzles[ i ].trace.size() );
+      for ( uint32_t hits : grade.counts ) {
+        text += ',' + std::to_string( hits );
+      }
+      text += '\n';
+    }
+    first = false;
+  }
+  out.write( text.data(), text.size() );
+}
+
+// the per-puzzle files that sit next to --output: traces and grades
+static std::unique_ptr<BufferedWriter> openSideOutput( const std::string &path ) {
+  if ( path.empty() )
+    return nullptr;
+  std::unique_ptr<BufferedWriter> out = BufferedWriter::open( path );
+  if ( !out )
+    std::cerr << "failed to open " << path << std::endl;
+  return out;
+}
+
+static bool finishSideOutput( BufferedWriter *out, const std::string &path, bool jsonArray, bool first ) {
+  if ( !out )
+    return true;
+  if ( jsonArray && first )
+    out->put( '[' );
+  if ( jsonArray )
+    out->write( "\n]\n", 3 );
+  if ( !out->flush() ) {
+    std::cerr << "failed to write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+template <int N>
+static int solveJsonBoards( ThreadPool &pool, const json &boards, const BatchOptions &options,
+                            std::vector<WorkerTotals> &workers ) {
+  std::vector<Puzzle<N>> puzzles = loadPuzzles<N>( boards );
+
+  std::unique_ptr<BufferedWriter> traces = openSideOutput( options.tracePath );
+  if ( !options.tracePath.empty() && !traces )
+    return 1;
+  std::unique_ptr<BufferedWriter> grades = openSideOutput( options.gradePath );
+  if ( !options.gradePath.empty() && !grades )
+    return 1;
+
+  solveBlock( pool, puzzles, puzzles.size(), workers, options );
+
+  if ( !options.outputPath.empty() ) {
+    json output = json::array();
+    for ( const Puzzle<N> &puzzle : puzzles ) {
+      output.push_back( boardToJson( puzzle.board ) );
+    }
+    std::ofstream out( options.outputPath );
+    out << output.dump() << std::endl;
+  }
+
+  bool first = true;
+  if ( traces )
+    writeTraces( *traces, puzzles, puzzles.size(), first );
+  bool gradesJson = isJsonPath( options.gradePath );
+  bool firstGrade = true;
+  if ( grades )
+    writeGrades( *grades, puzzles, puzzles.size(), gradesJson, firstGrade );
+  bool finished = finishSideOutput( traces.get(), options.tracePath, true, first );
+  return finishSideOutput( grades.get(), options.gradePath, gradesJson, firstGrade ) && finished ? 0 : 1;
+}
+
+// the board size is taken from the first board
+static int runJsonBatch( ThreadPool &pool, const std::string &path, const BatchOptions &options,
+                         std::vector<WorkerTotals> &workers ) {
+  try {
+    std::ifstream in( path );
+    const json boards = json::parse( in );
+    in.close();
+    int boxSize = boards.empty() ? 3 : jsonBoxSize( boards.at( 0 ).at( "value" ) );
+    return withBoxSize( boxSize, [ & ]( auto size ) {
+      return solveJsonBoards<decltype( size )::value>( pool, boards, options, workers );
+    } );
+  } catch ( const std::exception &e ) {
+    std::cerr << "failed to load " << path << ": " << e.what() << std::endl;
+    return 1;
+  }
+}
+
+// Solves a block at a time and writes each block back out in input order, so memory is
+// bounded by the block size. fill( block, capacity ) loads the next puzzles into the block
+// and returns how many, 0 once the input is used up.
+template <int N, typename Fill>
+static int solveStream( ThreadPool &pool, Fill &&fill, const BatchOptions &options,
+                        std::vector<WorkerTotals> &workers ) {
+  constexpr size_t cells = BasicBoard<N>::CELL_COUNT;
+  constexpr size_t blockSize = BATCH_BLOCK * Board::CELL_COUNT / cells;
+  const std::string &outputPath = options.outputPath;
+  std::unique_ptr<BufferedWriter> out;
+  if ( !outputPath.empty() ) {
+    out = BufferedWriter::open( outputPath );
+    if ( !out ) {
+      std::cerr << "failed to open " << outputPath << std::endl;
+      return 1;
+    }
+  }
+
+  std::unique_ptr<BufferedWriter> traces = openSideOutput( options.tracePath );
+  if ( !options.tracePath.empty() && !traces )
+    return 1;
+  std::unique_ptr<BufferedWriter> grades = openSideOutput( options.gradePath );
+  if ( !options.gradePath.empty() && !grades )
+    return 1;
+
+  std::vector<Puzzle<N>> block( blockSize );
+  bool firstTrace = true;
+  bool gradesJson = isJsonPath( options.gradePath );
+  bool firstGrade = true;
+  while ( size_t count = fill( block, blockSize ) ) {
+    solveBlock( pool, block, count, workers, options );
+
+    if ( out ) {
+      for ( size_t i = 0; i < count; i++ ) {
+        char *text = out->reserve( cells + 1 );
+        formatLineBoard( block[ i ].board, text );
+        text[ cells ] = '\n';
+      }
+    }
+    if ( traces )
+      writeTraces( *traces, block, count, firstTrace );
+    if ( grades )
+      writeGrades( *grades, block, count, gradesJson, firstGrade );
+  }
+
+  if ( !finishSideOutput( traces.get(), options.tracePath, true, firstTrace ) ||
+       !finishSideOutput( grades.get(), options.gradePath, gradesJson, firstGrade ) )
+    return 1;
+
+  if ( out && !out->flush() ) {
+    std::cerr << "failed to write " << outputPath << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Streams the line format: boards are parsed straight out of the mapping, and pages already
+// solved are handed back.
+template <int N>
+static int solveLines( ThreadPool &pool, MappedFile &file, const BatchOptions &options,
+                       std::vector<WorkerTotals> &workers, size_t &skipped ) {
+  size_t offset = 0;
+  auto fill = [ & ]( std::vector<Puzzle<N>> &block, size_t capacity ) {
+    file.release( offset );
+    size_t count = 0;
+    while ( count < capacity && offset < file.size() ) {
+      const char *line = file.data() + offset;
+      size_t length = nextLine( file.data(), file.size(), offset );
+      Puzzle<N> &puzzle = block[ count ];
+      if ( !parseLineBoard( line, length, puzzle.board ) ) {
+        skipped += length > 0;
+        continue;
+      }
+      puzzle.hasSolution = parseLineSolution( line, length, puzzle.solution );
+      count++;
+    }
+    return count;
+  };
+  return solveStream<N>( pool, fill, options, workers );
+}
+
+// the board size is taken from the first line holding a board, lines of other sizes are skipped
+static int runLineBatch( ThreadPool &pool, const std::string &path, const BatchOptions &options,
+                         std::vector<WorkerTotals> &workers, size_t &skipped ) {
+  MappedFile file;
+  if ( !file.open( path ) ) {
+    std::cerr << "failed to open " << path << std::endl;
+    return 1;
+  }
+
+  int boxSize = 0;
+  size_t offset = 0;
+  while ( boxSize == 0 && offset < file.size() ) {
+    const char *line = file.data() + offset;
+    size_t length = nextLine( file.data(), file.size(), offset );
+    boxSize = lineBoxSize( line, length );
+  }
+  return withBoxSize( boxSize, [ & ]( auto size ) {
+    return solveLines<decltype( size )::value>( pool, file, options, workers, skipped );
+  } );
+}
+
+// packed corpora are fetched record by record into the same blocks as the line format
+static int runCorpusBatch( ThreadPool &pool, const std::string &path, const BatchOptions &options,
+                           std::vector<WorkerTotals> &workers ) {
+  Corpus corpus;
+  if ( !corpus.open( path ) ) {
+    std::cerr << "failed to open " << path << " as a corpus" << std::endl;
+    return 1;
+  }
+
+  return withBoxSize( corpus.boxSize(), [ & ]( auto size ) {
+    constexpr int N = decltype( size )::value;
+    size_t next = 0;
+    bool corrupt = false;
+    auto fill = [ & ]( std::vector<Puzzle<N>> &block, size_t capacity ) {
+      size_t count = 0;
+      CorpusEntry<N> entry;
+      while ( count < capacity && next < corpus.size() && !corrupt ) {
+        if ( !corpus.fetch( next++, entry ) ) {
+          std::cerr << "corrupt record " << next - 1 << " in " << path << std::endl;
+          corrupt = true;
+          break;
+        }
+        Puzzle<N> &puzzle = block[ count++ ];
+        puzzle.board = entry.board;
+        puzzle.solution = entry.solution;
+        puzzle.hasSolution = entry.hasSolution;
+      }
+      return count;
+    };
+    int result = solveStream<N>( pool, fill, options, workers );
+    return corrupt ? 1 : result;
+  } );
+}
+
+static int usage() {
+  std::cerr << "usage: sudoku batch [file] [--threads N] [--output file] [--stats file] [--trace file] [--grade file]"
+               " [--perf]"
+               " [--lanes] [--time-limit ms] [--step-limit N] [--speculate N]"
+               " [--pipeline singles|basic|human|adaptive]"
+            << std::endl;
+  return 2;
+}
+
+int runBatch( int argc, char **argv ) {
+  std::string path = "boards.json";
+  BatchOptions options;
+  unsigned threads = std::thread::hardware_concurrency();
+  unsigned speculateThreads = 0;
+  for ( int i = 0; i < argc; i++ ) {
+    std::string arg = argv[ i ];
+    if ( arg == "--threads" && i + 1 < argc ) {
+      threads = std::stoul( argv[ ++i ] );
+    } else if ( arg == "--output" && i + 1 < argc ) {
+      options.outputPath = argv[ ++i ];
+    } else if ( arg == "--stats" && i + 1 < argc ) {
+      options.statsPath = argv[ ++i ];
+    } else if ( arg == "--trace" && i + 1 < argc ) {
+      options.tracePath = argv[ ++i ];
+    } else if ( arg == "--grade" && i + 1 < argc ) {
+      options.gradePath = argv[ ++i ];
+    } else if ( arg == "--perf" ) {
+      options.perf = true;
+    } else if ( arg == "--lanes" ) {
+      options.lanes = true;
+    } else if ( arg == "--time-limit" && i + 1 < argc ) {
+      options.timeLimit = std::chrono::microseconds( static_cast<int64_t>( std::stod( argv[ ++i ] ) * 1000 ) );
+    } else if ( arg == "--step-limit" && i + 1 < argc ) {
+      options.stepLimit = std::stoull( argv[ ++i ] );
+    } else if ( arg == "--speculate" && i + 1 < argc ) {
+      speculateThreads = std::stoul( argv[ ++i ] );
+    } else if ( arg == "--pipeline" && i + 1 < argc ) {
+      options.pipeline = parsePipeline( argv[ ++i ] );
+      if ( options.pipeline == PIPELINE_COUNT )
+        return usage();
+    } else if ( arg.rfind( "--", 0 ) == 0 ) {
+      return usage();
+    } else {
+      path = arg;
+    }
+  }
+
+  ThreadPool pool( threads );
+  std::unique_ptr<ThreadPool> speculation;
+  if ( speculateThreads > 0 ) {
+    speculation = std::make_unique<ThreadPool>( speculateThreads );
+    options.speculation = speculation.get();
+  }
+  std::vector<WorkerTotals> workers( pool.size() );
+  size_t skipped = 0;
+
+  auto batchStart = std::chrono::steady_clock::now();
+  int result = isJsonPath( path )     ? runJsonBatch( pool, path, options, workers )
+               : isCorpusPath( path ) ? runCorpusBatch( pool, path, options, workers )
+                                      : runLineBatch( pool, path, options, workers, skipped );
+  if ( result != 0 )
+    return result;
+  double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - batchStart ).count();
+
+  WorkerTotals totals;
+  bool perfAvailable = options.perf;
+  for ( const WorkerTotals &worker : workers ) {
+    for ( int i = 0; i < 3; i++ ) {
+      totals.counts[ i ] += worker.counts[ i ];
+    }
+    totals.searched += worker.searched;
+    for ( int i = 0; i < STOP_REASON_COUNT; i++ ) {
+      totals.stopped[ i ] += worker.stopped[ i ];
+    }
+    for ( int i = 0; i < DIFFICULTY_COUNT; i++ ) {
+      totals.difficulties[ i ] += worker.difficulties[ i ];
+    }
+    totals.latencies.merge( worker.latencies );
+    totals.stats.merge( worker.stats );
+    // workers that never picked up a chunk never tried to open their counters
+    if ( worker.perf && !worker.perf->isOpen() )
+      perfAvailable = false;
+  }
+  size_t puzzles = totals.latencies.count();
+
+  // the percentiles come from the histogram, so they are bucket lower bounds
+  std::cout << "puzzles:     " << puzzles << "\n"
+            << "skipped:     " << skipped << "\n"
+            << "threads:     " << pool.size() << "\n"
+            << "kernels:     " << kernelName() << "\n"
+            << "solved:      " << totals.counts[ SOLVED ] << "\n"
+            << "searched:    " << totals.searched << "\n"
+            << "stalled:     " << totals.counts[ STALLED ] << "\n";
+  // the puzzles among the stalled ones that ran out of their budget
+  if ( options.timeLimit.count() > 0 )
+    std::cout << "time limit:  " << totals.stopped[ STOP_TIME_LIMIT ] << "\n";
+  if ( options.stepLimit > 0 )
+    std::cout << "step limit:  " << totals.stopped[ STOP_STEP_LIMIT ] << "\n";
+  std::cout << "incorrect:   " << totals.counts[ INCORRECT ] << "\n"
+            << "seconds:     " << seconds << "\n"
+            << "puzzles/sec: " << ( seconds > 0 ? puzzles / seconds : 0.0 ) << "\n"
+            << "latency us:  p50 " << totals.latencies.percentile( 0.50 ) / 1000.0 << " p90 "
+            << totals.latencies.percentile( 0.90 ) / 1000.0 << " p99 " << totals.latencies.percentile( 0.99 ) / 1000.0
+            << " max " << totals.latencies.max() / 1000.0 << std::endl;
+  if ( !options.gradePath.empty() ) {
+    for ( int i = 0; i < DIFFICULTY_COUNT; i++ ) {
+      std::cout << difficultyName( i ) << ":" << std::string( 12 - std::strlen( difficultyName( i ) ), ' ' )
+                << totals.difficulties[ i ] << "\n";
+    }
+    std::cout << std::flush;
+  }
+
+  if ( !options.statsPath.empty() ) {
+    json report = { { "puzzles", puzzles },
+                    { "threads", pool.size() },
+                    { "kernels", kernelName() },
+                    { "perf", perfAvailable },
+                    { "techniques", totals.stats.toJson() } };
+    std::ofstream out( options.statsPath );
+    out << report.dump( 2 ) << std::endl;
+    if ( !out ) {
+      std::cerr << "failed to write " << options.statsPath << std::endl;
+      return 1;
+    }
+  }
+  if ( options.perf && !perfAvailable )
+    std::cerr << "perf counters unavailable, cache and branch misses not counted" << std::endl;
+
+  return totals.counts[ INCORRECT ] > 0 ? 1 : 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// sudoku batch [file] [--threads N] [--output file] [--stats file] [--trace file] [--grade file] [--perf]
+//              [--lanes] [--time-limit ms] [--step-limit N] [--speculate N]
+//              [--pipeline singles|basic|human|adaptive]
+int runBatch( int argc, char **argv );
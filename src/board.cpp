@@ -0,0 +1,129 @@
+#include "board.h"
+#include "kernels.h"
+#include <stdexcept>
+
+template <int N> void removeCandidates( BasicBoard<N> &board, int num, int cell ) {
+  uint32_t bit = digitBit( num );
+  for ( int peer : boardTables<N>.peers[ cell ] ) {
+    if ( board.candidates[ peer ] & bit ) {
+      board.candidates[ peer ] &= ~bit;
+      markDirty( board, peer );
+    }
+  }
+
+  // remove all candidates for this cell, which may leave a digit with one spot in its units
+  board.candidates[ cell ] = 0;
+  board.dirtyUnits |= boardTables<N>.cellUnitBits[ cell ];
+}
+
+template <int N> void placeValue( BasicBoard<N> &board, int num, int cell ) {
+  board.values[ cell ] = num;
+  for ( uint8_t unit : boardTables<N>.cellUnits[ cell ] ) {
+    board.unitValues[ unit ] |= digitBit( num );
+  }
+  removeCandidates( board, num, cell );
+}
+
+template <int N> void clearValue( BasicBoard<N> &board, int cell ) {
+  uint32_t bit = digitBit( board.values[ cell ] );
+  board.values[ cell ] = 0;
+  for ( uint8_t unit : boardTables<N>.cellUnits[ cell ] ) {
+    board.unitValues[ unit ] &= ~bit;
+  }
+
+  board.candidates[ cell ] = BasicBoard<N>::ALL_CANDIDATES & ~usedDigits( board, cell );
+  markDirty( board, cell );
+  for ( int peer : boardTables<N>.peers[ cell ] ) {
+    if ( board.values[ peer ] == 0 && !( usedDigits( board, peer ) & bit ) ) {
+      board.candidates[ peer ] |= bit;
+      markDirty( board, peer );
+    }
+  }
+}
+
+template <int N> bool isSolved( const BasicBoard<N> &board ) {
+  for ( uint8_t value : board.values ) {
+    if ( value == 0 )
+      return false;
+  }
+  return true;
+}
+
+template <int N> BasicBoard<N> boardFromValues( const uint8_t values[ BasicBoard<N>::CELL_COUNT ] ) {
+  using B = BasicBoard<N>;
+  B board = {};
+  for ( int cell = 0; cell < B::CELL_COUNT; cell++ ) {
+    int num = values[ cell ];
+    board.values[ cell ] = num;
+    if ( num > 0 ) {
+      for ( uint8_t unit : boardTables<N>.cellUnits[ cell ] ) {
+        board.unitValues[ unit ] |= digitBit( num );
+      }
+    }
+  }
+
+  for ( int cell = 0; cell < B::CELL_COUNT; cell++ ) {
+    if ( board.values[ cell ] == 0 )
+      board.candidates[ cell ] = B::ALL_CANDIDATES;
+  }
+  recomputeCandidates( board );
+  markAllDirty( board );
+  return board;
+}
+
+template <int N> BasicBoard<N> boardFromJson( const json &grid ) {
+  using B = BasicBoard<N>;
+  uint8_t values[ B::CELL_COUNT ];
+  if ( grid.size() != B::GRID_SIZE )
+    throw std::invalid_argument( "malformed board" );
+  for ( const json &row : grid ) {
+    if ( !row.is_array() || row.size() != B::GRID_SIZE )
+      throw std::invalid_argument( "malformed board" );
+  }
+  for ( int cell = 0; cell < B::CELL_COUNT; cell++ ) {
+    const json &num = grid.at( B::cellRow( cell ) ).at( B::cellCol( cell ) );
+    if ( !num.is_number_integer() || num.get<int64_t>() < 0 || num.get<int64_t>() > B::GRID_SIZE )
+      throw std::invalid_argument( "malformed board" );
+    values[ cell ] = num.get<int>();
+  }
+  return boardFromValues<N>( values );
+}
+
+template <int N> json boardToJson( const BasicBoard<N> &board ) {
+  using B = BasicBoard<N>;
+  json grid = json::array();
+  for ( int row = 0; row < B::GRID_SIZE; row++ ) {
+    json values = json::array();
+    for ( int col = 0; col < B::GRID_SIZE; col++ ) {
+      values.push_back( board.values[ row * B::GRID_SIZE + col ] );
+    }
+    grid.push_back( values );
+  }
+  return grid;
+}
+
+int jsonBoxSize( const json &grid ) {
+  switch ( grid.size() ) {
+  case 9:
+    return 3;
+  case 16:
+    return 4;
+  case 25:
+    return 5;
+  default:
+    return 0;
+  }
+}
+
+#define INSTANTIATE_BOARD( N )                                                                                         \
+  template void removeCandidates( BasicBoard<N> &, int, int );                                                         \
+  template void placeValue( BasicBoard<N> &, int, int );                                                               \
+  template void clearValue( BasicBoard<N> &, int );                                                                    \
+  template bool isSolved( const BasicBoard<N> & );                                                                     \
+  template BasicBoard<N> boardFromValues<N>( const uint8_t[] );                                                        \
+  template BasicBoard<N> boardFromJson<N>( const json & );                                                             \
+  template json boardToJson( const BasicBoard<N> & );
+
+INSTANTIATE_BOARD( 3 )
+INSTANTIATE_BOARD( 4 )
+INSTANTIATE_BOARD( 5 )
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <nlohmann/json.hpp>
+#include <type_traits>
+#include <utility>
+
+using json = nlohmann::json;
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+// Everything that depends on the board size is a template on the box size N: 3 for the
+// classic 9x9 board, 4 for 16x16 and 5 for 25x25. The sizes, the unit and peer tables and
+// the mask widths are all fixed at compile time, so each size gets its own fully unrolled
+// code and the 9x9 one is the same code a hand-written 9x9 solver would be.
+//
+// units 0 to GRID_SIZE - 1 are rows, then columns, then boxes
+template <int N> struct BasicBoard {
+  static constexpr int BOX_SIZE = N;
+  static constexpr int GRID_SIZE = N * N;
+  static constexpr int CELL_COUNT = GRID_SIZE * GRID_SIZE;
+  static constexpr int UNIT_COUNT = 3 * GRID_SIZE;
+  // the rest of the row, column and box, counting the box cells shared with the row and column once
+  static constexpr int PEER_COUNT = 3 * ( GRID_SIZE - 1 ) - 2 * ( BOX_SIZE - 1 );
+  static constexpr int CELL_WORDS = ( CELL_COUNT + 63 ) / 64;
+
+  // one bit per digit
+  using Mask = std::conditional_t<GRID_SIZE <= 16, uint16_t, uint32_t>;
+  // one bit per unit
+  using UnitMask = std::conditional_t<UNIT_COUNT <= 32, uint32_t,
+                                      std::conditional_t<UNIT_COUNT <= 64, uint64_t, uint128_t>>;
+  // a cell index
+  using Cell = std::conditional_t<CELL_COUNT <= 256, uint8_t, uint16_t>;
+
+  static constexpr Mask ALL_CANDIDATES = static_cast<Mask>( ( 1ull << GRID_SIZE ) - 1 );
+
+  static constexpr int rowUnit( int row ) { return row; }
+  static constexpr int colUnit( int col ) { return GRID_SIZE + col; }
+  static constexpr int boxUnit( int box ) { return 2 * GRID_SIZE + box; }
+
+  static constexpr int cellRow( int cell ) { return cell / GRID_SIZE; }
+  static constexpr int cellCol( int cell ) { return cell % GRID_SIZE; }
+  static constexpr int cellBox( int cell ) { return cellRow( cell ) / N * N + cellCol( cell ) / N; }
+
+  // One candidate mask per cell (bit num - 1 set while num is still possible) and one
+  // mask of placed digits per unit. Plain data, so copying a board is a memcpy.
+  //
+  // Every placement and elimination also queues the touched cells and their units, so
+  // the singles only look at what changed since they last ran.
+  uint8_t values[ CELL_COUNT ];
+  Mask candidates[ CELL_COUNT ];
+  Mask unitValues[ UNIT_COUNT ];
+  uint64_t dirtyCells[ CELL_WORDS ];
+  UnitMask dirtyUnits;
+};
+
+// the classic 9x9 board
+using Board = BasicBoard<3>;
+
+// calls fn( std::integral_constant<int, N>() ) with the box size as a compile-time constant;
+// sizes other than 4 and 5 get the 9x9 board
+template <typename Fn> decltype( auto ) withBoxSize( int boxSize, Fn &&fn ) {
+  switch ( boxSize ) {
+  case 4:
+    return fn( std::integral_constant<int, 4>() );
+  case 5:
+    return fn( std::integral_constant<int, 5>() );
+  default:
+    return fn( std::integral_constant<int, 3>() );
+  }
+}
+
+template <int N> struct BoardTables {
+  using B = BasicBoard<N>;
+  typename B::Cell unitCells[ B::UNIT_COUNT ][ B::GRID_SIZE ];
+  uint8_t cellUnits[ B::CELL_COUNT ][ 3 ];
+  typename B::UnitMask cellUnitBits[ B::CELL_COUNT ];
+  typename B::Cell peers[ B::CELL_COUNT ][ B::PEER_COUNT ];
+};
+
+template <int N> constexpr BoardTables<N> makeBoardTables() {
+  using B = BasicBoard<N>;
+  using UnitMask = typename B::UnitMask;
+  BoardTables<N> tables = {};
+  for ( int cell = 0; cell < B::CELL_COUNT; cell++ ) {
+    int row = B::cellRow( cell );
+    int col = B::cellCol( cell );
+    int box = B::cellBox( cell );
+    tables.cellUnits[ cell ][ 0 ] = B::rowUnit( row );
+    tables.cellUnits[ cell ][ 1 ] = B::colUnit( col );
+    tables.cellUnits[ cell ][ 2 ] = B::boxUnit( box );
+    tables.cellUnitBits[ cell ] = ( UnitMask( 1 ) << B::rowUnit( row ) ) | ( UnitMask( 1 ) << B::colUnit( col ) ) |
+                                  ( UnitMask( 1 ) << B::boxUnit( box ) );
+  }
+
+  for ( int i = 0; i < B::GRID_SIZE; i++ ) {
+    for ( int j = 0; j < B::GRID_SIZE; j++ ) {
+      int boxRow = ( i / N ) * N + j / N;
+      int boxCol = ( i % N ) * N + j % N;
+      tables.unitCells[ B::rowUnit( i ) ][ j ] = i * B::GRID_SIZE + j;
+      tables.unitCells[ B::colUnit( i ) ][ j ] = j * B::GRID_SIZE + i;
+      tables.unitCells[ B::boxUnit( i ) ][ j ] = boxRow * B::GRID_SIZE + boxCol;
+    }
+  }
+
+  // row, column, then the box cells in neither; walking the units rather than every other
+  // cell keeps 25x25 well within the compilers' constexpr step limits
+  for ( int cell = 0; cell < B::CELL_COUNT; cell++ ) {
+    int count = 0;
+    for ( int other : tables.unitCells[ tables.cellUnits[ cell ][ 0 ] ] ) {
+      if ( other != cell )
+        tables.peers[ cell ][ count++ ] = other;
+    }
+    for ( int other : tables.unitCells[ tables.cellUnits[ cell ][ 1 ] ] ) {
+      if ( other != cell )
+        tables.peers[ cell ][ count++ ] = other;
+    }
+    for ( int other : tables.unitCells[ tables.cellUnits[ cell ][ 2 ] ] ) {
+      if ( B::cellRow( other ) != B::cellRow( cell ) && B::cellCol( other ) != B::cellCol( cell ) )
+        tables.peers[ cell ][ count++ ] = other;
+    }
+  }
+
+  return tables;
+}
+
+template <int N> inline constexpr BoardTables<N> boardTables = makeBoardTables<N>();
+
+inline uint32_t digitBit( int num ) { return 1u << ( num - 1 ); }
+
+// lowest set bit and bit count of a unit mask, whatever its width
+inline int lowestUnit( uint32_t units ) { return __builtin_ctz( units ); }
+inline int lowestUnit( uint64_t units ) { return __builtin_ctzll( units ); }
+inline int lowestUnit( uint128_t units ) {
+  uint64_t low = static_cast<uint64_t>( units );
+  return low ? __builtin_ctzll( low ) : 64 + __builtin_ctzll( static_cast<uint64_t>( units >> 64 ) );
+}
+inline int unitCount( uint32_t units ) { return __builtin_popcount( units ); }
+inline int unitCount( uint64_t units ) { return __builtin_popcountll( units ); }
+inline int unitCount( uint128_t units ) {
+  return __builtin_popcountll( static_cast<uint64_t>( units ) ) +
+         __builtin_popcountll( static_cast<uint64_t>( units >> 64 ) );
+}
+
+template <int N> inline uint32_t usedDigits( const BasicBoard<N> &board, int cell ) {
+  const uint8_t *units = boardTables<N>.cellUnits[ cell ];
+  return board.unitValues[ units[ 0 ] ] | board.unitValues[ units[ 1 ] ] | board.unitValues[ units[ 2 ] ];
+}
+
+template <int N> inline bool isValid( const BasicBoard<N> &board, int num, int cell ) {
+  return !( usedDigits( board, cell ) & digitBit( num ) );
+}
+
+template <int N> inline bool hasCandidate( const BasicBoard<N> &board, int num, int cell ) {
+  return board.candidates[ cell ] & digitBit( num );
+}
+
+template <int N> inline void markDirty( BasicBoard<N> &board, int cell ) {
+  board.dirtyCells[ cell >> 6 ] |= 1ull << ( cell & 63 );
+  board.dirtyUnits |= boardTables<N>.cellUnitBits[ cell ];
+}
+
+template <int N> inline void markAllDirty( BasicBoard<N> &board ) {
+  using B = BasicBoard<N>;
+  for ( int word = 0; word < B::CELL_WORDS; word++ ) {
+    board.dirtyCells[ word ] = ~0ull;
+  }
+  if ( B::CELL_COUNT % 64 )
+    board.dirtyCells[ B::CELL_WORDS - 1 ] = ( 1ull << ( B::CELL_COUNT % 64 ) ) - 1;
+  board.dirtyUnits = ( typename B::UnitMask( 1 ) << B::UNIT_COUNT ) - 1;
+}
+
+// next queued cell, -1 once the queue is empty
+template <int N> inline int popDirtyCell( BasicBoard<N> &board ) {
+  for ( int word = 0; word < BasicBoard<N>::CELL_WORDS; word++ ) {
+    if ( board.dirtyCells[ word ] ) {
+      int cell = word * 64 + __builtin_ctzll( board.dirtyCells[ word ] );
+      board.dirtyCells[ word ] &= board.dirtyCells[ word ] - 1;
+      return cell;
+    }
+  }
+  return -1;
+}
+
+template <int N> inline int popDirtyUnit( BasicBoard<N> &board ) {
+  if ( !board.dirtyUnits )
+    return -1;
+  int unit = lowestUnit( board.dirtyUnits );
+  board.dirtyUnits &= board.dirtyUnits - 1;
+  return unit;
+}
+
+template <int N> inline bool removeCandidate( BasicBoard<N> &board, int num, int cell ) {
+  uint32_t bit = digitBit( num );
+  if ( !( board.candidates[ cell ] & bit ) )
+    return false;
+  board.candidates[ cell ] &= ~bit;
+  markDirty( board, cell );
+  return true;
+}
+
+// same digits and candidates, whatever is queued
+template <int N> inline bool sameState( const BasicBoard<N> &a, const BasicBoard<N> &b ) {
+  return std::memcmp( a.values, b.values, sizeof( a.values ) ) == 0 &&
+         std::memcmp( a.candidates, b.candidates, sizeof( a.candidates ) ) == 0;
+}
+
+template <int N> void removeCandidates( BasicBoard<N> &board, int num, int cell );
+template <int N> void placeValue( BasicBoard<N> &board, int num, int cell );
+// takes a placed digit back out; only exact while the candidates are just what the placed
+// digits leave, i.e. before any technique has removed some
+template <int N> void clearValue( BasicBoard<N> &board, int cell );
+template <int N> bool isSolved( const BasicBoard<N> &board );
+
+template <int N> BasicBoard<N> boardFromValues( const uint8_t values[ BasicBoard<N>::CELL_COUNT ] );
+// throws std::invalid_argument( "malformed board" ) unless the grid is GRID_SIZE rows of
+// GRID_SIZE integers from 0 to GRID_SIZE, the same cells parseLineBoard accepts
+template <int N> BasicBoard<N> boardFromJson( const json &grid );
+template <int N> json boardToJson( const BasicBoard<N> &board );
+
+// box size of a boards.json grid from its row count, 0 if it isn't 9, 16 or 25 rows
+int jsonBoxSize( const json &grid );
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// the clock and the cancel flag are only looked at every this many steps (a power of two)
+#define BUDGET_CHECK_INTERVAL 64
+
+// why a solve stopped
+enum StopReason : uint8_t {
+  STOP_SOLVED,
+  STOP_NO_SOLUTION,  // the search ran out of branches: the board is contradictory
+  STOP_TIME_LIMIT,
+  STOP_STEP_LIMIT,
+  STOP_CANCELLED,
+  STOP_REASON_COUNT
+};
+
+inline const char *stopReasonName( int reason ) {
+  static const char *names[ STOP_REASON_COUNT ] = { "solved", "no_solution", "time_limit", "step_limit", "cancelled" };
+  return names[ reason ];
+}
+
+// Set from any thread to make the solves watching it give up at their next check.
+class CancelToken {
+public:
+  void cancel() { cancelled.store( true, std::memory_order_relaxed ); }
+  bool isCancelled() const { return cancelled.load( std::memory_order_relaxed ); }
+
+private:
+  std::atomic<bool> cancelled { false };
+};
+
+// Limits for one solve. A step is one logical step or one search node. spend() is on the
+// hot path: for a search node it's a counter and a compare, and only every
+// BUDGET_CHECK_INTERVAL nodes also reads the clock and the cancel token. A logical step
+// can take a thousand times as long as a node, so those pass slow and check every time.
+// Once spent it stays spent and reason() says why.
+class SolveBudget {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  SolveBudget() = default;
+
+  void setTimeLimit( Clock::duration limit ) {
+    deadline = Clock::now() + limit;
+    timed = true;
+  }
+  void setStepLimit( uint64_t limit ) { stepLimit = limit; }
+  bool hasStepLimit() const { return stepLimit != UINT64_MAX; }
+  // not owned, must outlive the solve
+  void watch( const CancelToken *token ) { cancelToken = token; }
+  // counts steps against a total shared with other budgets, e.g. the branches of one parallel
+  // search, so the step limit holds for all of them together; not owned either
+  void share( std::atomic<uint64_t> *total ) { sharedSteps = total; }
+
+  // charges one step, false once the budget is gone
+  bool spend( bool slow = false ) {
+    if ( exhausted )
+      return false;
+    uint64_t total = ++stepCount;
+    if ( sharedSteps )
+      total = sharedSteps->fetch_add( 1, std::memory_order_relaxed ) + 1;
+    if ( total > stepLimit )
+      return stop( STOP_STEP_LIMIT );
+    if ( slow || stepCount % BUDGET_CHECK_INTERVAL == 0 ) {
+      if ( cancelToken && cancelToken->isCancelled() )
+        return stop( STOP_CANCELLED );
+      if ( timed && Clock::now() >= deadline )
+        return stop( STOP_TIME_LIMIT );
+    }
+    return true;
+  }
+
+  // the clock and the cancel token without charging a step, for a thread that only waits
+  bool check() {
+    if ( exhausted )
+      return false;
+    if ( cancelToken && cancelToken->isCancelled() )
+      return stop( STOP_CANCELLED );
+    if ( timed && Clock::now() >= deadline )
+      return stop( STOP_TIME_LIMIT );
+    return true;
+  }
+
+  // charges steps spent on copies of this budget, e.g. by the branches of a parallel
+  // search, and stops for why unless that's STOP_SOLVED
+  void charge( uint64_t steps, StopReason why = STOP_SOLVED ) {
+    stepCount += steps;
+    if ( why != STOP_SOLVED && !exhausted )
+      stop( why );
+  }
+
+  bool isExhausted() const { return exhausted; }
+  StopReason reason() const { return stopReason; }
+  uint64_t steps() const { return stepCount; }
+
+private:
+  bool stop( StopReason why ) {
+    exhausted = true;
+    stopReason = why;
+    return false;
+  }
+
+  uint64_t stepCount = 0;
+  uint64_t stepLimit = UINT64_MAX;
+  Clock::time_point deadline;
+  bool timed = false;
+  const CancelToken *cancelToken = nullptr;
+  std::atomic<uint64_t> *sharedSteps = nullptr;
+  bool exhausted = false;
+  StopReason stopReason = STOP_SOLVED;
+};
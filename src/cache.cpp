@@ -0,0 +1,129 @@
+#include "cache.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#define CACHE_MAGIC "SUDOKUK1"
+
+static std::string keyOf( const uint8_t values[ Board::CELL_COUNT ] ) {
+  return std::string( reinterpret_cast<const char *>( values ), Board::CELL_COUNT );
+}
+
+SolutionCache::SolutionCache( size_t capacity ) : shardCapacity( std::max<size_t>( 1, capacity / CACHE_SHARDS ) ) {}
+
+SolutionCache::Shard &SolutionCache::shardFor( const std::string &key ) {
+  return shards[ std::hash<std::string>()( key ) % CACHE_SHARDS ];
+}
+
+bool SolutionCache::find( const std::string &key, std::string &solution ) {
+  Shard &shard = shardFor( key );
+  std::lock_guard<std::mutex> lock( shard.mutex );
+  auto found = shard.index.find( key );
+  if ( found == shard.index.end() )
+    return false;
+  shard.entries.splice( shard.entries.begin(), shard.entries, found->second );
+  solution = found->second->solution;
+  return true;
+}
+
+void SolutionCache::store( const std::string &key, const std::string &solution ) {
+  Shard &shard = shardFor( key );
+  std::lock_guard<std::mutex> lock( shard.mutex );
+  auto found = shard.index.find( key );
+  if ( found != shard.index.end() ) {
+    shard.entries.splice( shard.entries.begin(), shard.entries, found->second );
+    return;
+  }
+  // the evicted entry's node is reused for the new one
+  if ( shard.entries.size() >= shardCapacity ) {
+    shard.index.erase( shard.entries.back().key );
+    shard.entries.splice( shard.entries.begin(), shard.entries, std::prev( shard.entries.end() ) );
+    shard.entries.front() = { key, solution };
+  } else {
+    shard.entries.push_front( { key, solution } );
+  }
+  shard.index.emplace( key, shard.entries.begin() );
+}
+
+bool SolutionCache::lookup( const uint8_t values[ Board::CELL_COUNT ], CacheKey &key,
+                            uint8_t solution[ Board::CELL_COUNT ] ) {
+  std::string found;
+  if ( find( keyOf( values ), found ) ) {
+    std::memcpy( solution, found.data(), Board::CELL_COUNT );
+    hitCount++;
+    return true;
+  }
+
+  std::memcpy( key.values, values, Board::CELL_COUNT );
+  canonicalize( values, key.canonical, key.symmetry );
+  if ( !find( keyOf( key.canonical ), found ) ) {
+    missCount++;
+    return false;
+  }
+  fromCanonical( reinterpret_cast<const uint8_t *>( found.data() ), key.symmetry, solution );
+  // so the next exact repeat skips canonicalizing
+  store( keyOf( values ), keyOf( solution ) );
+  hitCount++;
+  return true;
+}
+
+void SolutionCache::insert( const CacheKey &key, const uint8_t solution[ Board::CELL_COUNT ] ) {
+  uint8_t canonicalSolution[ Board::CELL_COUNT ];
+  for ( int cell = 0; cell < Board::CELL_COUNT; cell++ ) {
+    canonicalSolution[ cell ] = key.symmetry.digits[ solution[ key.symmetry.cells[ cell ] ] ];
+  }
+  store( keyOf( key.canonical ), keyOf( canonicalSolution ) );
+  store( keyOf( key.values ), keyOf( solution ) );
+}
+
+size_t SolutionCache::size() const {
+  size_t total = 0;
+  for ( const Shard &shard : shards ) {
+    std::lock_guard<std::mutex> lock( shard.mutex );
+    total += shard.entries.size();
+  }
+  return total;
+}
+
+bool SolutionCache::save( const std::string &path ) const {
+  std::string out( CACHE_MAGIC );
+  std::string entries;
+  uint64_t count = 0;
+  for ( const Shard &shard : shards ) {
+    std::lock_guard<std::mutex> lock( shard.mutex );
+    for ( auto entry = shard.entries.rbegin(); entry != shard.entries.rend(); ++entry ) {
+      entries += entry->key;
+      entries += entry->solution;
+      count++;
+    }
+  }
+  out.append( reinterpret_cast<const char *>( &count ), sizeof( count ) );
+  out += entries;
+
+  std::ofstream file( path, std::ios::binary );
+  file.write( out.data(), out.size() );
+  return static_cast<bool>( file );
+}
+
+bool SolutionCache::load( const std::string &path ) {
+  std::ifstream file( path, std::ios::binary );
+  std::string in( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+  uint64_t count;
+  if ( in.size() < 16 || in.compare( 0, 8, CACHE_MAGIC ) != 0 )
+    return false;
+  std::memcpy( &count, in.data() + 8, sizeof( count ) );
+  if ( ( in.size() - 16 ) / ( 2 * Board::CELL_COUNT ) != count || ( in.size() - 16 ) % ( 2 * Board::CELL_COUNT ) )
+    return false;
+  for ( size_t i = 16; i < in.size(); i++ ) {
+    uint8_t num = in[ i ];
+    bool inSolution = ( i - 16 ) % ( 2 * Board::CELL_COUNT ) >= Board::CELL_COUNT;
+    if ( num > Board::GRID_SIZE || ( inSolution && num == 0 ) )
+      return false;
+  }
+
+  for ( size_t offset = 16; offset < in.size(); offset += 2 * Board::CELL_COUNT ) {
+    store( in.substr( offset, Board::CELL_COUNT ), in.substr( offset + Board::CELL_COUNT, Board::CELL_COUNT ) );
+  }
+  return true;
+}
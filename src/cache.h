@@ -0,0 +1,62 @@
+#pragma once
+
+#include "canonical.h"
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#define CACHE_SHARDS 16
+
+// What lookup found out about a puzzle, for handing its solution to insert on a miss.
+struct CacheKey {
+  uint8_t values[ Board::CELL_COUNT ];
+  uint8_t canonical[ Board::CELL_COUNT ];
+  Symmetry symmetry;
+};
+
+// Least-recently-used map from 9x9 puzzles to their solutions, keyed by canonical form so
+// a relabeled, transposed or shuffled copy of a solved puzzle is a hit too. Puzzles are
+// also stored as given, so an exact repeat is found without canonicalizing. Sharded by
+// key hash, each shard with its own lock and its own share of the capacity.
+class SolutionCache {
+public:
+  explicit SolutionCache( size_t capacity );
+
+  // true with the puzzle's solution in its own layout and digits if it or a copy of it has
+  // been stored; otherwise key is filled in for insert. values must be digits 0 to 9.
+  bool lookup( const uint8_t values[ Board::CELL_COUNT ], CacheKey &key, uint8_t solution[ Board::CELL_COUNT ] );
+  // solution is in the layout of the puzzle key was looked up for
+  void insert( const CacheKey &key, const uint8_t solution[ Board::CELL_COUNT ] );
+
+  size_t size() const;
+  uint64_t hits() const { return hitCount; }
+  uint64_t misses() const { return missCount; }
+
+  // binary: "SUDOKUK1", uint64 entries, then per entry the 81 puzzle digits and the 81
+  // solution digits, least recently used first so a load restores the order
+  bool save( const std::string &path ) const;
+  // false if the file isn't a cache or doesn't add up; entries past capacity are dropped
+  bool load( const std::string &path );
+
+private:
+  struct Entry {
+    std::string key;
+    std::string solution;
+  };
+  struct alignas( 64 ) Shard {
+    mutable std::mutex mutex;
+    std::list<Entry> entries;  // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+  };
+
+  Shard &shardFor( const std::string &key );
+  bool find( const std::string &key, std::string &solution );
+  void store( const std::string &key, const std::string &solution );
+
+  size_t shardCapacity;
+  Shard shards[ CACHE_SHARDS ];
+  std::atomic<uint64_t> hitCount { 0 };
+  std::atomic<uint64_t> missCount { 0 };
+};
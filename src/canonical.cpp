@@ -0,0 +1,199 @@
+#include "canonical.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#define GRID 9
+
+// One transformation still in the running, built a row at a time: the rows placed so far
+// are fixed, the column order is fixed by the first row, and digits get their labels as
+// they first appear.
+struct Candidate {
+  const uint8_t *grid;  // the board or its transpose
+  uint8_t rows[ GRID ];
+  uint8_t cols[ GRID ];
+  uint8_t labels[ GRID + 1 ];
+  uint8_t nextLabel;
+  uint8_t bandsUsed;
+};
+
+static const uint8_t permutations[ 6 ][ 3 ] = { { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 },
+                                                { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 } };
+
+// A first row reads as its blanks and then 1, 2, 3... in order, so only where the blanks go
+// matters: as many as possible at the front, i.e. stacks by blank count, fullest first,
+// blanks first within each. The score orders rows by that, bigger is smaller.
+static int firstRowScore( const uint8_t *row ) {
+  int counts[ 3 ];
+  for ( int stack = 0; stack < 3; stack++ ) {
+    counts[ stack ] = ( row[ stack * 3 ] == 0 ) + ( row[ stack * 3 + 1 ] == 0 ) + ( row[ stack * 3 + 2 ] == 0 );
+  }
+  std::sort( counts, counts + 3, []( int a, int b ) { return a > b; } );
+  return counts[ 0 ] * 16 + counts[ 1 ] * 4 + counts[ 2 ];
+}
+
+// every column order that puts row in its best form
+static void addFirstRows( const uint8_t *grid, int row, std::vector<Candidate> &candidates ) {
+  const uint8_t *values = grid + row * GRID;
+  int blanks[ 3 ];
+  for ( int stack = 0; stack < 3; stack++ ) {
+    blanks[ stack ] = ( values[ stack * 3 ] == 0 ) + ( values[ stack * 3 + 1 ] == 0 ) + ( values[ stack * 3 + 2 ] == 0 );
+  }
+  for ( const uint8_t *stacks : permutations ) {
+    if ( blanks[ stacks[ 0 ] ] < blanks[ stacks[ 1 ] ] || blanks[ stacks[ 1 ] ] < blanks[ stacks[ 2 ] ] )
+      continue;
+    // within each stack, the orders that put its blanks first
+    int orders[ 3 ][ 6 ], orderCount[ 3 ] = {};
+    for ( int i = 0; i < 3; i++ ) {
+      int stack = stacks[ i ];
+      for ( int p = 0; p < 6; p++ ) {
+        const uint8_t *order = permutations[ p ];
+        bool blanksFirst = true;
+        for ( int j = 0; j + 1 < 3; j++ ) {
+          blanksFirst &= !( values[ stack * 3 + order[ j ] ] != 0 && values[ stack * 3 + order[ j + 1 ] ] == 0 );
+        }
+        if ( blanksFirst )
+          orders[ i ][ orderCount[ i ]++ ] = p;
+      }
+    }
+    for ( int a = 0; a < orderCount[ 0 ]; a++ ) {
+      for ( int b = 0; b < orderCount[ 1 ]; b++ ) {
+        for ( int c = 0; c < orderCount[ 2 ]; c++ ) {
+          if ( candidates.size() >= CANONICAL_MAX_CANDIDATES )
+            return;
+          Candidate candidate = {};
+          candidate.grid = grid;
+          candidate.rows[ 0 ] = row;
+          candidate.bandsUsed = 1 << ( row / 3 );
+          const int picked[ 3 ] = { orders[ 0 ][ a ], orders[ 1 ][ b ], orders[ 2 ][ c ] };
+          for ( int i = 0; i < 3; i++ ) {
+            for ( int j = 0; j < 3; j++ ) {
+              candidate.cols[ i * 3 + j ] = stacks[ i ] * 3 + permutations[ picked[ i ] ][ j ];
+            }
+          }
+          candidate.nextLabel = 1;
+          for ( int col = 0; col < GRID; col++ ) {
+            uint8_t num = values[ candidate.cols[ col ] ];
+            if ( num && !candidate.labels[ num ] )
+              candidate.labels[ num ] = candidate.nextLabel++;
+          }
+          candidates.push_back( candidate );
+        }
+      }
+    }
+  }
+}
+
+// row of the candidate's grid in its column order and labels, labeling new digits on the
+// way; stops early, returning 1, as soon as it's bigger than bound (when there is one)
+static int relabelRow( Candidate &candidate, int row, uint8_t out[ GRID ], const uint8_t *bound ) {
+  const uint8_t *values = candidate.grid + row * GRID;
+  bool equal = bound != nullptr;
+  for ( int col = 0; col < GRID; col++ ) {
+    uint8_t num = values[ candidate.cols[ col ] ];
+    if ( num && !candidate.labels[ num ] )
+      candidate.labels[ num ] = candidate.nextLabel++;
+    out[ col ] = num ? candidate.labels[ num ] : 0;
+    if ( equal && out[ col ] != bound[ col ] ) {
+      if ( out[ col ] > bound[ col ] )
+        return 1;
+      equal = false;
+    }
+  }
+  return equal ? 0 : -1;
+}
+
+void canonicalize( const uint8_t values[ Board::CELL_COUNT ], uint8_t canonical[ Board::CELL_COUNT ],
+                   Symmetry &symmetry ) {
+  uint8_t transposed[ Board::CELL_COUNT ];
+  for ( int cell = 0; cell < Board::CELL_COUNT; cell++ ) {
+    transposed[ cell ] = values[ ( cell % GRID ) * GRID + cell / GRID ];
+  }
+  const uint8_t *grids[ 2 ] = { values, transposed };
+
+  thread_local std::vector<Candidate> candidates, extended;
+  candidates.clear();
+  int best = -1;
+  for ( const uint8_t *grid : grids ) {
+    for ( int row = 0; row < GRID; row++ ) {
+      best = std::max( best, firstRowScore( grid + row * GRID ) );
+    }
+  }
+  for ( const uint8_t *grid : grids ) {
+    for ( int row = 0; row < GRID; row++ ) {
+      if ( firstRowScore( grid + row * GRID ) == best )
+        addFirstRows( grid, row, candidates );
+    }
+  }
+  uint8_t bestRow[ GRID ];
+  relabelRow( candidates[ 0 ], candidates[ 0 ].rows[ 0 ], bestRow, nullptr );
+  std::copy( bestRow, bestRow + GRID, canonical );
+
+  // each further row: try every row the candidate could put there, keep the smallest
+  for ( int position = 1; position < GRID; position++ ) {
+    extended.clear();
+    bool first = true;
+    for ( const Candidate &candidate : candidates ) {
+      int previous = candidate.rows[ position - 1 ];
+      for ( int row = 0; row < GRID; row++ ) {
+        bool allowed = position % 3 ? row / 3 == previous / 3 : !( candidate.bandsUsed >> ( row / 3 ) & 1 );
+        for ( int used = 0; allowed && used < position; used++ ) {
+          allowed = candidate.rows[ used ] != row;
+        }
+        if ( !allowed )
+          continue;
+        // labels are all the row changes, so try it on a copy of those before copying the rest
+        Candidate next;
+        std::memcpy( next.labels, candidate.labels, sizeof( next.labels ) );
+        next.nextLabel = candidate.nextLabel;
+        next.grid = candidate.grid;
+        std::memcpy( next.cols, candidate.cols, sizeof( next.cols ) );
+        uint8_t out[ GRID ];
+        int order = relabelRow( next, row, out, first ? nullptr : bestRow );
+        if ( order > 0 )
+          continue;
+        std::memcpy( next.rows, candidate.rows, sizeof( next.rows ) );
+        next.bandsUsed = candidate.bandsUsed;
+        if ( order < 0 ) {
+          extended.clear();
+          std::copy( out, out + GRID, bestRow );
+          first = false;
+        }
+        if ( extended.size() < CANONICAL_MAX_CANDIDATES ) {
+          next.rows[ position ] = row;
+          next.bandsUsed |= 1 << ( row / 3 );
+          extended.push_back( next );
+        }
+      }
+    }
+    std::copy( bestRow, bestRow + GRID, canonical + position * GRID );
+    candidates.swap( extended );
+  }
+
+  // digits the board doesn't use get the labels left over, in order
+  Candidate &chosen = candidates[ 0 ];
+  for ( int num = 1; num <= GRID; num++ ) {
+    if ( !chosen.labels[ num ] )
+      chosen.labels[ num ] = chosen.nextLabel++;
+  }
+  symmetry.digits[ 0 ] = 0;
+  std::copy( chosen.labels + 1, chosen.labels + GRID + 1, symmetry.digits + 1 );
+  bool transpose = chosen.grid == transposed;
+  for ( int row = 0; row < GRID; row++ ) {
+    for ( int col = 0; col < GRID; col++ ) {
+      int r = chosen.rows[ row ], c = chosen.cols[ col ];
+      symmetry.cells[ row * GRID + col ] = transpose ? c * GRID + r : r * GRID + c;
+    }
+  }
+}
+
+void fromCanonical( const uint8_t canonical[ Board::CELL_COUNT ], const Symmetry &symmetry,
+                    uint8_t values[ Board::CELL_COUNT ] ) {
+  uint8_t original[ GRID + 1 ] = {};
+  for ( int num = 1; num <= GRID; num++ ) {
+    original[ symmetry.digits[ num ] ] = num;
+  }
+  for ( int cell = 0; cell < Board::CELL_COUNT; cell++ ) {
+    values[ symmetry.cells[ cell ] ] = original[ canonical[ cell ] ];
+  }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "board.h"
+
+// 9x9 only. Two boards are the same puzzle if one can be turned into the other by
+// transposing, reordering bands, stacks, rows within a band and columns within a stack, and
+// relabeling digits. The canonical form is the lexicographically smallest of all of those
+// (reading cells row by row, blanks lowest), with digits numbered in order of appearance, so
+// every copy of a puzzle has the same one.
+//
+// Very sparse boards tie on so many transformations that the search keeps at most
+// CANONICAL_MAX_CANDIDATES of them; past that the form is still a transformation of the
+// board, just not necessarily the smallest one.
+#define CANONICAL_MAX_CANDIDATES 4096
+
+struct Symmetry {
+  uint8_t cells[ Board::CELL_COUNT ];  // canonical cell i is the board's cell cells[ i ]
+  uint8_t digits[ Board::GRID_SIZE + 1 ];  // the board's digit d is canonical digit digits[ d ], 0 stays 0
+};
+
+// canonical[ i ] = symmetry.digits[ values[ symmetry.cells[ i ] ] ]
+void canonicalize( const uint8_t values[ Board::CELL_COUNT ], uint8_t canonical[ Board::CELL_COUNT ],
+                   Symmetry &symmetry );
+// the other way: a canonical board (typically a solution) in the original board's layout and digits
+void fromCanonical( const uint8_t canonical[ Board::CELL_COUNT ], const Symmetry &symmetry,
+                    uint8_t values[ Board::CELL_COUNT ] );
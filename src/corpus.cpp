@@ -0,0 +1,313 @@
+#include "corpus.h"
+#include "technique.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <strings.h>
+#include <vector>
+
+template <int N> static constexpr size_t digitBytes() {
+  return N == 3 ? ( BasicBoard<N>::CELL_COUNT + 1 ) / 2 : BasicBoard<N>::CELL_COUNT;
+}
+
+template <int N> static constexpr size_t maskBytes() { return ( BasicBoard<N>::CELL_COUNT + 7 ) / 8; }
+
+template <int N> static constexpr size_t recordSize( bool hasSolution ) {
+  return 2 + ( hasSolution ? maskBytes<N>() : 0 ) + digitBytes<N>();
+}
+
+template <int N> static void packDigits( const uint8_t values[], uint8_t *out ) {
+  constexpr int cells = BasicBoard<N>::CELL_COUNT;
+  if ( N != 3 ) {
+    std::memcpy( out, values, cells );
+    return;
+  }
+  for ( int cell = 0; cell < cells; cell += 2 ) {
+    out[ cell / 2 ] = values[ cell ] | ( cell + 1 < cells ? values[ cell + 1 ] << 4 : 0 );
+  }
+}
+
+template <int N> static void unpackDigits( const uint8_t *in, uint8_t values[] ) {
+  constexpr int cells = BasicBoard<N>::CELL_COUNT;
+  if ( N != 3 ) {
+    std::memcpy( values, in, cells );
+    return;
+  }
+  for ( int cell = 0; cell < cells; cell++ ) {
+    values[ cell ] = ( in[ cell / 2 ] >> ( cell % 2 * 4 ) ) & 0x0f;
+  }
+}
+
+// the puzzle as a clue mask over the solution when there is one, its digits otherwise
+template <int N>
+static void writeRecord( BufferedWriter &out, const uint8_t clues[], const uint8_t *solution, int difficulty ) {
+  uint8_t *record = reinterpret_cast<uint8_t *>( out.reserve( recordSize<N>( solution ) ) );
+  record[ 0 ] = difficulty;
+  record[ 1 ] = solution ? CORPUS_HAS_SOLUTION : 0;
+  if ( !solution ) {
+    packDigits<N>( clues, record + 2 );
+    return;
+  }
+  uint8_t *mask = record + 2;
+  std::memset( mask, 0, maskBytes<N>() );
+  for ( int cell = 0; cell < BasicBoard<N>::CELL_COUNT; cell++ ) {
+    if ( clues[ cell ] )
+      mask[ cell / 8 ] |= 1 << ( cell % 8 );
+  }
+  packDigits<N>( solution, mask + maskBytes<N>() );
+}
+
+bool Corpus::open( const std::string &path ) {
+  if ( !file.open( path, false ) || file.size() < CORPUS_HEADER_SIZE )
+    return false;
+  const char *header = file.data();
+  if ( std::memcmp( header, CORPUS_MAGIC, 8 ) != 0 )
+    return false;
+  uint32_t boxSize;
+  uint64_t puzzles;
+  std::memcpy( &boxSize, header + 8, sizeof( boxSize ) );
+  std::memcpy( &puzzles, header + 16, sizeof( puzzles ) );
+  if ( boxSize < 3 || boxSize > 5 || puzzles > ( file.size() - CORPUS_HEADER_SIZE ) / sizeof( uint64_t ) )
+    return false;
+  box = boxSize;
+  count = puzzles;
+  offsets = reinterpret_cast<const uint8_t *>( header + CORPUS_HEADER_SIZE );
+  return true;
+}
+
+template <int N> bool Corpus::fetch( size_t index, CorpusEntry<N> &entry ) const {
+  using B = BasicBoard<N>;
+  if ( N != box || index >= count )
+    return false;
+  uint64_t offset;
+  std::memcpy( &offset, offsets + index * sizeof( offset ), sizeof( offset ) );
+  if ( offset > file.size() || file.size() - offset < recordSize<N>( false ) )
+    return false;
+  const uint8_t *record = reinterpret_cast<const uint8_t *>( file.data() + offset );
+  entry.difficulty = record[ 0 ];
+  entry.hasSolution = record[ 1 ] & CORPUS_HAS_SOLUTION;
+  if ( entry.hasSolution && file.size() - offset < recordSize<N>( true ) )
+    return false;
+
+  uint8_t clues[ B::CELL_COUNT ], solution[ B::CELL_COUNT ];
+  if ( entry.hasSolution ) {
+    const uint8_t *mask = record + 2;
+    unpackDigits<N>( mask + maskBytes<N>(), solution );
+    for ( int cell = 0; cell < B::CELL_COUNT; cell++ ) {
+      if ( solution[ cell ] == 0 || solution[ cell ] > B::GRID_SIZE )
+        return false;
+      clues[ cell ] = mask[ cell / 8 ] & ( 1 << ( cell % 8 ) ) ? solution[ cell ] : 0;
+    }
+    entry.solution = boardFromValues<N>( solution );
+  } else {
+    unpackDigits<N>( record + 2, clues );
+    for ( uint8_t num : clues ) {
+      if ( num > B::GRID_SIZE )
+        return false;
+    }
+  }
+  entry.board = boardFromValues<N>( clues );
+  return true;
+}
+
+template bool Corpus::fetch( size_t, CorpusEntry<3> & ) const;
+template bool Corpus::fetch( size_t, CorpusEntry<4> & ) const;
+template bool Corpus::fetch( size_t, CorpusEntry<5> & ) const;
+
+bool isCorpusPath( const std::string &path ) {
+  return path.size() >= 7 && path.compare( path.size() - 7, 7, ".corpus" ) == 0;
+}
+
+static int difficultyIndex( const std::string &name ) {
+  for ( int i = 0; i < DIFFICULTY_COUNT; i++ ) {
+    if ( strcasecmp( name.c_str(), difficultyName( i ) ) == 0 )
+      return i;
+  }
+  return CORPUS_NO_DIFFICULTY;
+}
+
+// The clue mask encoding rebuilds the clues from the solution, so it's only used for a
+// complete solution that every clue agrees with; anything else would rewrite the puzzle.
+template <int N> static bool solutionFitsClues( const uint8_t clues[], const uint8_t solution[] ) {
+  for ( int cell = 0; cell < BasicBoard<N>::CELL_COUNT; cell++ ) {
+    if ( solution[ cell ] == 0 || solution[ cell ] > BasicBoard<N>::GRID_SIZE ||
+         ( clues[ cell ] && clues[ cell ] != solution[ cell ] ) )
+      return false;
+  }
+  return true;
+}
+
+// Writes every board the source visits. The source is walked twice, once to lay out the
+// index and once to write the records, so nothing but the offsets is held in memory. A
+// solution that doesn't fit its clues is dropped and the bare clues are stored instead.
+template <int N, typename Source> static int writeCorpus( Source &&forEachBoard, const std::string &outPath ) {
+  std::vector<uint64_t> offsets;
+  uint64_t size = 0, mismatched = 0;
+  forEachBoard( [ & ]( const uint8_t *clues, const uint8_t *solution, int ) {
+    if ( solution && !solutionFitsClues<N>( clues, solution ) ) {
+      solution = nullptr;
+      mismatched++;
+    }
+    offsets.push_back( size );
+    size += recordSize<N>( solution );
+  } );
+  if ( mismatched > 0 )
+    std::cerr << mismatched << " puzzles have a solution that disagrees with their clues, stored without it"
+              << std::endl;
+
+  std::unique_ptr<BufferedWriter> out = BufferedWriter::open( outPath );
+  if ( !out ) {
+    std::cerr << "failed to open " << outPath << std::endl;
+    return 1;
+  }
+  char header[ CORPUS_HEADER_SIZE ] = {};
+  uint32_t boxSize = N;
+  uint64_t count = offsets.size();
+  std::memcpy( header, CORPUS_MAGIC, 8 );
+  std::memcpy( header + 8, &boxSize, sizeof( boxSize ) );
+  std::memcpy( header + 16, &count, sizeof( count ) );
+  out->write( header, sizeof( header ) );
+
+  uint64_t recordsStart = CORPUS_HEADER_SIZE + count * sizeof( uint64_t );
+  for ( uint64_t &offset : offsets ) {
+    offset += recordsStart;
+  }
+  out->write( reinterpret_cast<const char *>( offsets.data() ), count * sizeof( uint64_t ) );
+
+  forEachBoard( [ & ]( const uint8_t *clues, const uint8_t *solution, int difficulty ) {
+    if ( solution && !solutionFitsClues<N>( clues, solution ) )
+      solution = nullptr;
+    writeRecord<N>( *out, clues, solution, difficulty );
+  } );
+  if ( !out->flush() ) {
+    std::cerr << "failed to write " << outPath << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+static int packJson( const std::string &inPath, const std::string &outPath ) {
+  std::ifstream in( inPath );
+  const json boards = json::parse( in );
+  in.close();
+
+  // the board size is taken from the first board, boards of other sizes are left out
+  int boxSize = boards.empty() ? 3 : jsonBoxSize( boards.at( 0 ).at( "value" ) );
+  return withBoxSize( boxSize, [ & ]( auto size ) {
+    constexpr int N = decltype( size )::value;
+    auto forEachBoard = [ & ]( auto &&visit ) {
+      for ( const json &entry : boards ) {
+        const json &value = entry.at( "value" );
+        if ( jsonBoxSize( value ) != N )
+          continue;
+        BasicBoard<N> board = boardFromJson<N>( value ), solution;
+        bool hasSolution = entry.contains( "solution" );
+        if ( hasSolution )
+          solution = boardFromJson<N>( entry.at( "solution" ) );
+        int difficulty = entry.contains( "difficulty" ) ? difficultyIndex( entry.at( "difficulty" ) )
+                                                        : CORPUS_NO_DIFFICULTY;
+        visit( board.values, hasSolution ? solution.values : nullptr, difficulty );
+      }
+    };
+    return writeCorpus<N>( forEachBoard, outPath );
+  } );
+}
+
+static int packLines( const std::string &inPath, const std::string &outPath ) {
+  MappedFile file;
+  if ( !file.open( inPath ) ) {
+    std::cerr << "failed to open " << inPath << std::endl;
+    return 1;
+  }
+
+  // the board size is taken from the first line holding a board, lines of other sizes are left out
+  int boxSize = 0;
+  size_t offset = 0;
+  while ( boxSize == 0 && offset < file.size() ) {
+    const char *line = file.data() + offset;
+    size_t length = nextLine( file.data(), file.size(), offset );
+    boxSize = lineBoxSize( line, length );
+  }
+  return withBoxSize( boxSize, [ & ]( auto size ) {
+    constexpr int N = decltype( size )::value;
+    constexpr size_t cells = BasicBoard<N>::CELL_COUNT;
+    auto forEachBoard = [ & ]( auto &&visit ) {
+      size_t offset = 0;
+      while ( offset < file.size() ) {
+        const char *line = file.data() + offset;
+        size_t length = nextLine( file.data(), file.size(), offset );
+        BasicBoard<N> board, solution;
+        if ( !parseLineBoard( line, length, board ) )
+          continue;
+        bool hasSolution = parseLineSolution( line, length, solution );
+        int difficulty = hasSolution && length > 2 * cells + 2
+                             ? difficultyIndex( std::string( line + 2 * cells + 2, length - 2 * cells - 2 ) )
+                             : CORPUS_NO_DIFFICULTY;
+        visit( board.values, hasSolution ? solution.values : nullptr, difficulty );
+      }
+    };
+    return writeCorpus<N>( forEachBoard, outPath );
+  } );
+}
+
+int packCorpus( const std::string &inPath, const std::string &outPath ) {
+  return isJsonPath( inPath ) ? packJson( inPath, outPath ) : packLines( inPath, outPath );
+}
+
+// to boards.json for a .json path and puzzle,solution,difficulty lines otherwise
+int unpackCorpus( const std::string &inPath, const std::string &outPath ) {
+  Corpus corpus;
+  if ( !corpus.open( inPath ) ) {
+    std::cerr << "failed to open " << inPath << " as a corpus" << std::endl;
+    return 1;
+  }
+  std::unique_ptr<BufferedWriter> out = BufferedWriter::open( outPath );
+  if ( !out ) {
+    std::cerr << "failed to open " << outPath << std::endl;
+    return 1;
+  }
+
+  bool asJson = isJsonPath( outPath );
+  bool ok = withBoxSize( corpus.boxSize(), [ & ]( auto size ) {
+    constexpr int N = decltype( size )::value;
+    constexpr size_t cells = BasicBoard<N>::CELL_COUNT;
+    CorpusEntry<N> entry;
+    if ( asJson )
+      out->write( "[\n", 2 );
+    for ( size_t i = 0; i < corpus.size(); i++ ) {
+      if ( !corpus.fetch( i, entry ) ) {
+        std::cerr << "corrupt record " << i << " in " << inPath << std::endl;
+        return false;
+      }
+      const char *difficulty = entry.difficulty < DIFFICULTY_COUNT ? difficultyName( entry.difficulty ) : nullptr;
+      if ( asJson ) {
+        json board = { { "value", boardToJson( entry.board ) } };
+        if ( entry.hasSolution )
+          board[ "solution" ] = boardToJson( entry.solution );
+        if ( difficulty )
+          board[ "difficulty" ] = difficulty;
+        std::string text = board.dump();
+        if ( i > 0 )
+          out->write( "  ,\n", 4 );
+        out->write( "  ", 2 );
+        out->write( text.data(), text.size() );
+        out->put( '\n' );
+        continue;
+      }
+      formatLineBoard( entry.board, out->reserve( cells ) );
+      if ( entry.hasSolution ) {
+        out->put( ',' );
+        formatLineBoard( entry.solution, out->reserve( cells ) );
+        if ( difficulty ) {
+          out->put( ',' );
+          out->write( difficulty, std::strlen( difficulty ) );
+        }
+      }
+      out->put( '\n' );
+    }
+    if ( asJson )
+      out->write( "]\n", 2 );
+    return true;
+  } );
+  return ok && out->flush() ? 0 : 1;
+}
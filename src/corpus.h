@@ -0,0 +1,54 @@
+#pragma once
+
+#include "board.h"
+#include "lineio.h"
+#include <cstdint>
+#include <string>
+
+// Packed binary corpus, all integers little-endian:
+//
+//   header   "SUDOKUC1", uint32 box size, uint32 reserved, uint64 puzzle count
+//   index    uint64 file offset of each record
+//   records  difficulty byte (0 easy to 3 expert, 0xff unknown), flags byte, then either
+//              - with a solution: one bit per cell set for clues, then the solution's digits
+//              - without: the clue digits, 0 for blanks
+//
+// Digits are packed two to a byte on 9x9 boards and take a byte each on larger ones. A
+// 9x9 puzzle with its solution is 54 bytes plus 8 of index, and fetching puzzle i reads
+// its index entry and its record and nothing else.
+
+#define CORPUS_MAGIC          "SUDOKUC1"
+#define CORPUS_HEADER_SIZE    24
+#define CORPUS_HAS_SOLUTION   0x01
+#define CORPUS_NO_DIFFICULTY  0xff
+
+template <int N> struct CorpusEntry {
+  BasicBoard<N> board;
+  BasicBoard<N> solution;
+  bool hasSolution;
+  int difficulty;  // CORPUS_NO_DIFFICULTY if the source didn't say
+};
+
+class Corpus {
+public:
+  // maps the file for random access and checks the header and index bounds
+  bool open( const std::string &path );
+
+  size_t size() const { return count; }
+  int boxSize() const { return box; }
+
+  // false if index is out of range, N isn't the corpus' box size or the record is cut short
+  template <int N> bool fetch( size_t index, CorpusEntry<N> &entry ) const;
+
+private:
+  MappedFile file;
+  const uint8_t *offsets = nullptr;
+  size_t count = 0;
+  int box = 0;
+};
+
+bool isCorpusPath( const std::string &path );
+
+// the convert subcommand's corpus directions: boards.json or lines in, or a corpus out to either
+int packCorpus( const std::string &inPath, const std::string &outPath );
+int unpackCorpus( const std::string &inPath, const std::string &outPath );
@@ -0,0 +1,178 @@
+#include "generate.h"
+#include "board.h"
+#include "lineio.h"
+#include "pool.h"
+#include "search.h"
+#include "solver.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+#define GENERATE_GRAIN 16
+// puzzles generated per round before they are written out
+#define GENERATE_BLOCK 4096
+
+template <int N> struct Generated {
+  BasicBoard<N> puzzle;
+  BasicBoard<N> solution;
+  int difficulty;
+};
+
+// A random full grid, then clues taken out in random order as long as the puzzle keeps a
+// single solution. What is left is minimal: no remaining clue can go without a second
+// solution appearing.
+template <int N> static void generatePuzzle( uint64_t seed, Generated<N> &out ) {
+  using B = BasicBoard<N>;
+  std::mt19937_64 random( seed );
+
+  uint8_t empty[ B::CELL_COUNT ] = {};
+  out.solution = boardFromValues<N>( empty );
+  searchRandomSolution( out.solution, random );
+
+  typename B::Cell order[ B::CELL_COUNT ];
+  std::iota( order, order + B::CELL_COUNT, 0 );
+  std::shuffle( order, order + B::CELL_COUNT, random );
+  out.puzzle = out.solution;
+  for ( int cell : order ) {
+    int num = out.puzzle.values[ cell ];
+    clearValue( out.puzzle, cell );
+    // nothing else fits, so the clue is implied by the others
+    if ( out.puzzle.candidates[ cell ] == digitBit( num ) )
+      continue;
+
+    // the puzzle had one solution with the clue, so without it there is a second one exactly
+    // when some solution puts another digit here; looking only for those prunes most of the tree
+    B board = out.puzzle;
+    board.candidates[ cell ] &= ~digitBit( num );
+    markAllDirty( board );
+    if ( countSolutions( board, 1 ) != 0 )
+      placeValue( out.puzzle, num, cell );
+  }
+  markAllDirty( out.puzzle );
+
+  // graded by the hardest technique the solver's ladder needs
+  BasicBoard<N> board = out.puzzle;
+  SolveTrace trace;
+  if ( !solveLogically( board, nullptr, &trace ) )
+    trace.push_back( SEARCH );
+  out.difficulty = gradeTrace( trace ).difficulty;
+}
+
+// the boards.json schema, one object per line like convert writes it
+template <int N> static void writeJson( BufferedWriter &out, const Generated<N> &generated, bool first ) {
+  nlohmann::ordered_json entry = { { "value", boardToJson( generated.puzzle ) },
+                                   { "solution", boardToJson( generated.solution ) },
+                                   { "difficulty", difficultyName( generated.difficulty ) } };
+  std::string text = entry.dump();
+  if ( !first )
+    out.write( "  ,\n", 4 );
+  out.write( "  ", 2 );
+  out.write( text.data(), text.size() );
+  out.put( '\n' );
+}
+
+// puzzle,solution,difficulty
+template <int N> static void writeLine( BufferedWriter &out, const Generated<N> &generated ) {
+  formatLineBoard( generated.puzzle, out.reserve( BasicBoard<N>::CELL_COUNT ) );
+  out.put( ',' );
+  formatLineBoard( generated.solution, out.reserve( BasicBoard<N>::CELL_COUNT ) );
+  out.put( ',' );
+  const char *difficulty = difficultyName( generated.difficulty );
+  out.write( difficulty, std::strlen( difficulty ) );
+  out.put( '\n' );
+}
+
+template <int N>
+static void generateAll( ThreadPool &pool, BufferedWriter &out, bool asJson, size_t count, uint64_t seed,
+                         size_t difficulties[ DIFFICULTY_COUNT ] ) {
+  std::vector<Generated<N>> block( std::min<size_t>( count, GENERATE_BLOCK ) );
+  if ( asJson )
+    out.write( "[\n", 2 );
+  for ( size_t start = 0; start < count; start += block.size() ) {
+    size_t blockCount = std::min( block.size(), count - start );
+    pool.parallelFor( blockCount, GENERATE_GRAIN, [ & ]( size_t begin, size_t end, unsigned ) {
+      for ( size_t i = begin; i < end; i++ ) {
+        // seeded per puzzle, so the output only depends on the seed and not on the thread count
+        generatePuzzle( seed + ( start + i ) * 0x9e3779b97f4a7c15ull, block[ i ] );
+      }
+    } );
+
+    // written in order once the whole block is done
+    for ( size_t i = 0; i < blockCount; i++ ) {
+      if ( asJson )
+        writeJson( out, block[ i ], start + i == 0 );
+      else
+        writeLine( out, block[ i ] );
+      difficulties[ block[ i ].difficulty ]++;
+    }
+  }
+  if ( asJson )
+    out.write( "]\n", 2 );
+}
+
+static int usage() {
+  std::cerr << "usage: sudoku generate [--count N] [--threads N] [--seed S] [--box-size 3|4|5] [--output file]"
+            << std::endl;
+  return 2;
+}
+
+int runGenerate( int argc, char **argv ) {
+  size_t count = 1000;
+  unsigned threads = std::thread::hardware_concurrency();
+  uint64_t seed = std::random_device()();
+  int boxSize = 3;
+  std::string outputPath = "-";
+  for ( int i = 0; i < argc; i++ ) {
+    std::string arg = argv[ i ];
+    if ( arg == "--count" && i + 1 < argc ) {
+      count = std::stoull( argv[ ++i ] );
+    } else if ( arg == "--threads" && i + 1 < argc ) {
+      threads = std::stoul( argv[ ++i ] );
+    } else if ( arg == "--seed" && i + 1 < argc ) {
+      seed = std::stoull( argv[ ++i ] );
+    } else if ( arg == "--box-size" && i + 1 < argc ) {
+      boxSize = std::stoi( argv[ ++i ] );
+      if ( boxSize < 3 || boxSize > 5 )
+        return usage();
+    } else if ( arg == "--output" && i + 1 < argc ) {
+      outputPath = argv[ ++i ];
+    } else {
+      return usage();
+    }
+  }
+
+  std::unique_ptr<BufferedWriter> out = BufferedWriter::open( outputPath );
+  if ( !out ) {
+    std::cerr << "failed to open " << outputPath << std::endl;
+    return 1;
+  }
+
+  ThreadPool pool( threads );
+  size_t difficulties[ DIFFICULTY_COUNT ] = {};
+  auto start = std::chrono::steady_clock::now();
+  withBoxSize( boxSize, [ & ]( auto size ) {
+    generateAll<decltype( size )::value>( pool, *out, isJsonPath( outputPath ), count, seed, difficulties );
+  } );
+  if ( !out->flush() ) {
+    std::cerr << "failed to write " << outputPath << std::endl;
+    return 1;
+  }
+  double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+  // the puzzles may be going to stdout, so the report goes to stderr
+  std::cerr << "puzzles:     " << count << "\n"
+            << "threads:     " << pool.size() << "\n"
+            << "seed:        " << seed << "\n";
+  for ( int i = 0; i < DIFFICULTY_COUNT; i++ ) {
+    std::cerr << difficultyName( i ) << ":" << std::string( 12 - std::strlen( difficultyName( i ) ), ' ' )
+              << difficulties[ i ] << "\n";
+  }
+  std::cerr << "seconds:     " << seconds << "\n"
+            << "puzzles/sec: " << ( seconds > 0 ? count / seconds : 0.0 ) << std::endl;
+  return 0;
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// sudoku generate [--count N] [--threads N] [--seed S] [--box-size 3|4|5] [--output file]
+int runGenerate( int argc, char **argv );
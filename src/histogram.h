@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#define HISTOGRAM_SUB_BUCKETS 8
+#define HISTOGRAM_BUCKETS     ( 64 * HISTOGRAM_SUB_BUCKETS )
+
+// Log-linear latency histogram in nanoseconds: 8 buckets per power of two, so any
+// percentile is within 12.5% of the exact value and memory stays fixed at 4 KiB no
+// matter how many samples are recorded.
+class LatencyHistogram {
+public:
+  LatencyHistogram() { clear(); }
+
+  void clear() {
+    std::memset( counts, 0, sizeof( counts ) );
+    total = 0;
+    maxValue = 0;
+  }
+
+  void record( uint64_t ns ) {
+    counts[ bucketOf( ns ) ]++;
+    total++;
+    if ( ns > maxValue )
+      maxValue = ns;
+  }
+
+  void merge( const LatencyHistogram &other ) {
+    for ( int i = 0; i < HISTOGRAM_BUCKETS; i++ ) {
+      counts[ i ] += other.counts[ i ];
+    }
+    total += other.total;
+    if ( other.maxValue > maxValue )
+      maxValue = other.maxValue;
+  }
+
+  // lower bound of the bucket holding the p-th sample, in nanoseconds
+  uint64_t percentile( double p ) const {
+    if ( total == 0 )
+      return 0;
+    uint64_t rank = static_cast<uint64_t>( p * total );
+    if ( rank >= total )
+      rank = total - 1;
+    uint64_t seen = 0;
+    for ( int i = 0; i < HISTOGRAM_BUCKETS; i++ ) {
+      seen += counts[ i ];
+      if ( seen > rank )
+        return lowerBound( i );
+    }
+    return maxValue;
+  }
+
+  uint64_t count() const { return total; }
+  uint64_t max() const { return maxValue; }
+  uint64_t bucketCount( int bucket ) const { return counts[ bucket ]; }
+
+  static int bucketOf( uint64_t ns ) {
+    if ( ns < HISTOGRAM_SUB_BUCKETS )
+      return ns;
+    int exponent = 63 - __builtin_clzll( ns );
+    return ( exponent - 2 ) * HISTOGRAM_SUB_BUCKETS + ( ( ns >> ( exponent - 3 ) ) & ( HISTOGRAM_SUB_BUCKETS - 1 ) );
+  }
+
+  static uint64_t lowerBound( int bucket ) {
+    if ( bucket < HISTOGRAM_SUB_BUCKETS )
+      return bucket;
+    int exponent = bucket / HISTOGRAM_SUB_BUCKETS + 2;
+    return ( uint64_t( HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS ) ) << ( exponent - 3 );
+  }
+
+private:
+  uint64_t counts[ HISTOGRAM_BUCKETS ];
+  uint64_t total;
+  uint64_t maxValue;
+};
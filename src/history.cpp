@@ -0,0 +1,141 @@
+#include "history.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#define HISTORY_MAGIC "SUDOKUH1"
+
+template <int N>
+void StepHistory<N>::record( const BasicBoard<N> &before, const BasicBoard<N> &after, Technique technique ) {
+  for ( int cell = 0; cell < BasicBoard<N>::CELL_COUNT; cell++ ) {
+    auto removed = static_cast<typename BasicBoard<N>::Mask>( before.candidates[ cell ] & ~after.candidates[ cell ] );
+    uint8_t value = before.values[ cell ] != after.values[ cell ] ? after.values[ cell ] : 0;
+    if ( removed || value )
+      changes.push_back( { static_cast<typename BasicBoard<N>::Cell>( cell ), value, removed } );
+  }
+  stepEnds.push_back( changes.size() );
+  techniques.push_back( technique );
+}
+
+template <int N> void StepHistory<N>::redo( BasicBoard<N> &board, size_t step ) const {
+  for ( size_t i = step ? stepEnds[ step - 1 ] : 0; i < stepEnds[ step ]; i++ ) {
+    const CellChange<N> &change = changes[ i ];
+    if ( change.value ) {
+      board.values[ change.cell ] = change.value;
+      for ( uint8_t unit : boardTables<N>.cellUnits[ change.cell ] ) {
+        board.unitValues[ unit ] |= digitBit( change.value );
+      }
+    }
+    board.candidates[ change.cell ] &= ~change.removed;
+  }
+}
+
+template <int N> void StepHistory<N>::undo( BasicBoard<N> &board, size_t step ) const {
+  for ( size_t i = step ? stepEnds[ step - 1 ] : 0; i < stepEnds[ step ]; i++ ) {
+    const CellChange<N> &change = changes[ i ];
+    if ( change.value ) {
+      board.values[ change.cell ] = 0;
+      for ( uint8_t unit : boardTables<N>.cellUnits[ change.cell ] ) {
+        board.unitValues[ unit ] &= ~digitBit( change.value );
+      }
+    }
+    board.candidates[ change.cell ] |= change.removed;
+  }
+}
+
+template <int N> void StepHistory<N>::seek( BasicBoard<N> &board, size_t from, size_t to ) const {
+  while ( from < to ) {
+    redo( board, from++ );
+  }
+  while ( from > to ) {
+    undo( board, --from );
+  }
+}
+
+template <typename T> static void append( std::string &out, T value ) {
+  out.append( reinterpret_cast<const char *>( &value ), sizeof( value ) );
+}
+
+template <typename T> static bool take( const std::string &in, size_t &offset, T &value ) {
+  if ( in.size() - offset < sizeof( value ) )
+    return false;
+  std::memcpy( &value, in.data() + offset, sizeof( value ) );
+  offset += sizeof( value );
+  return true;
+}
+
+template <int N> bool StepHistory<N>::save( const std::string &path ) const {
+  std::string out( HISTORY_MAGIC );
+  append<uint32_t>( out, N );
+  append<uint32_t>( out, techniques.size() );
+  append<uint64_t>( out, changes.size() );
+  out.append( reinterpret_cast<const char *>( initial.values ), BasicBoard<N>::CELL_COUNT );
+  out.append( techniques.begin(), techniques.end() );
+  for ( uint32_t end : stepEnds ) {
+    append( out, end );
+  }
+  for ( const CellChange<N> &change : changes ) {
+    append<uint16_t>( out, change.cell );
+    append<uint8_t>( out, change.value );
+    append<uint32_t>( out, change.removed );
+  }
+
+  std::ofstream file( path, std::ios::binary );
+  file.write( out.data(), out.size() );
+  return static_cast<bool>( file );
+}
+
+template <int N> bool StepHistory<N>::load( const std::string &path ) {
+  using B = BasicBoard<N>;
+  std::ifstream file( path, std::ios::binary );
+  std::string in( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+  size_t offset = 8;
+  uint32_t boxSize, steps;
+  uint64_t changeCount;
+  if ( in.compare( 0, 8, HISTORY_MAGIC ) != 0 || !take( in, offset, boxSize ) || boxSize != N ||
+       !take( in, offset, steps ) || !take( in, offset, changeCount ) )
+    return false;
+  // every field is fixed size, so the counts have to account for the file exactly
+  if ( in.size() - offset != B::CELL_COUNT + steps * 5ull + changeCount * 7 )
+    return false;
+
+  uint8_t values[ B::CELL_COUNT ];
+  std::memcpy( values, in.data() + offset, B::CELL_COUNT );
+  offset += B::CELL_COUNT;
+  for ( uint8_t num : values ) {
+    if ( num > B::GRID_SIZE )
+      return false;
+  }
+
+  std::vector<uint8_t> loadedTechniques( in.begin() + offset, in.begin() + offset + steps );
+  offset += steps;
+  std::vector<uint32_t> loadedEnds( steps );
+  for ( uint32_t i = 0; i < steps; i++ ) {
+    if ( !take( in, offset, loadedEnds[ i ] ) || loadedTechniques[ i ] >= TECHNIQUE_COUNT || loadedEnds[ i ] > changeCount ||
+         ( i > 0 && loadedEnds[ i ] < loadedEnds[ i - 1 ] ) )
+      return false;
+  }
+  if ( steps > 0 && loadedEnds.back() != changeCount )
+    return false;
+
+  std::vector<CellChange<N>> loadedChanges( changeCount );
+  for ( CellChange<N> &change : loadedChanges ) {
+    uint16_t cell;
+    uint8_t value;
+    uint32_t removed;
+    if ( !take( in, offset, cell ) || !take( in, offset, value ) || !take( in, offset, removed ) ||
+         cell >= B::CELL_COUNT || value > B::GRID_SIZE || ( removed & ~uint32_t( B::ALL_CANDIDATES ) ) )
+      return false;
+    change = { static_cast<typename B::Cell>( cell ), value, static_cast<typename B::Mask>( removed ) };
+  }
+
+  initial = boardFromValues<N>( values );
+  techniques = std::move( loadedTechniques );
+  stepEnds = std::move( loadedEnds );
+  changes = std::move( loadedChanges );
+  return true;
+}
+
+template class StepHistory<3>;
+template class StepHistory<4>;
+template class StepHistory<5>;
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "board.h"
+#include "technique.h"
+#include <string>
+#include <vector>
+
+// What one step did to one cell. Steps only ever place digits and take candidates away,
+// so this is all it takes to play a step forward or back.
+template <int N> struct CellChange {
+  typename BasicBoard<N>::Cell cell;
+  uint8_t value;                          // digit placed, 0 if the cell kept its value
+  typename BasicBoard<N>::Mask removed;  // candidates the step took away
+};
+
+// The steps of one solve as the cells each changed rather than as whole boards, so a 9x9
+// step costs 4 bytes per touched cell. Moving a board between steps touches only the cells
+// the steps in between changed. The dirty queues aren't tracked: boards played through the
+// history are for looking at, not for solving further.
+template <int N> class StepHistory {
+public:
+  explicit StepHistory( const BasicBoard<N> &start = BasicBoard<N>() ) : initial( start ) {}
+
+  // appends the step that took the board from before to after
+  void record( const BasicBoard<N> &before, const BasicBoard<N> &after, Technique technique );
+
+  size_t size() const { return techniques.size(); }
+  const BasicBoard<N> &start() const { return initial; }
+  Technique technique( size_t step ) const { return static_cast<Technique>( techniques[ step ] ); }
+
+  // board is the state before step (after it for undo)
+  void redo( BasicBoard<N> &board, size_t step ) const;
+  void undo( BasicBoard<N> &board, size_t step ) const;
+  // takes board from the state after from steps to the state after to steps
+  void seek( BasicBoard<N> &board, size_t from, size_t to ) const;
+
+  // binary: "SUDOKUH1", uint32 box size, uint32 steps, uint64 changes, the start board's
+  // digits, one technique byte and one uint32 end-of-step change index per step, then each
+  // change as uint16 cell, uint8 digit and uint32 removed candidates
+  bool save( const std::string &path ) const;
+  // false if the file isn't a history of this board size or doesn't add up
+  bool load( const std::string &path );
+
+private:
+  BasicBoard<N> initial;
+  std::vector<CellChange<N>> changes;
+  std::vector<uint32_t> stepEnds;  // step i changed changes[ stepEnds[ i - 1 ], stepEnds[ i ] )
+  std::vector<uint8_t> techniques;
+};
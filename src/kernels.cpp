@@ -0,0 +1,230 @@
+#include "kernels.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+// below this many queued units, counting them one by one beats a vector pass over all 27
+#define KERNEL_UNIT_THRESHOLD 8
+
+template <int N>
+static inline void countUnit( const BasicBoard<N> &board, int unit, typename BasicBoard<N>::Mask &once,
+                              typename BasicBoard<N>::Mask &twice ) {
+  const auto *cells = boardTables<N>.unitCells[ unit ];
+  typename BasicBoard<N>::Mask seen = 0, seenTwice = 0;
+  for ( int i = 0; i < BasicBoard<N>::GRID_SIZE; i++ ) {
+    seenTwice |= seen & board.candidates[ cells[ i ] ];
+    seen |= board.candidates[ cells[ i ] ];
+  }
+  once = seen;
+  twice = seenTwice;
+}
+
+template <int N>
+static void countUnitCandidatesScalar( const BasicBoard<N> &board, typename BasicBoard<N>::Mask once[],
+                                       typename BasicBoard<N>::Mask twice[] ) {
+  for ( int unit = 0; unit < BasicBoard<N>::UNIT_COUNT; unit++ ) {
+    countUnit( board, unit, once[ unit ], twice[ unit ] );
+  }
+}
+
+template <int N> static void recomputeCandidatesScalar( BasicBoard<N> &board ) {
+  for ( int cell = 0; cell < BasicBoard<N>::CELL_COUNT; cell++ ) {
+    board.candidates[ cell ] &= ~usedDigits( board, cell );
+  }
+}
+
+#ifdef HAVE_X86_KERNELS
+
+// the vector kernels are written for the 9x9 board only
+static constexpr int BOX_SIZE = Board::BOX_SIZE;
+static constexpr int GRID_SIZE = Board::GRID_SIZE;
+static constexpr int UNIT_COUNT = Board::UNIT_COUNT;
+#define UNIT_LANES 32
+
+// candidates transposed so that lane u of row k holds the k-th cell of unit u;
+// the 5 lanes past the last unit stay zero
+struct alignas( 32 ) UnitLanes {
+  uint16_t lanes[ GRID_SIZE ][ UNIT_LANES ];
+};
+
+static inline void transposeUnits( const Board &board, UnitLanes &units ) {
+  for ( int k = 0; k < GRID_SIZE; k++ ) {
+    uint16_t *lanes = units.lanes[ k ];
+    for ( int row = 0; row < GRID_SIZE; row++ ) {
+      lanes[ Board::rowUnit( row ) ] = board.candidates[ row * GRID_SIZE + k ];
+    }
+    // the k-th cell of every column is just row k
+    std::memcpy( lanes + Board::colUnit( 0 ), board.candidates + k * GRID_SIZE, GRID_SIZE * sizeof( uint16_t ) );
+    for ( int box = 0; box < GRID_SIZE; box++ ) {
+      lanes[ Board::boxUnit( box ) ] = board.candidates[ boardTables<3>.unitCells[ Board::boxUnit( box ) ][ k ] ];
+    }
+    std::memset( lanes + UNIT_COUNT, 0, ( UNIT_LANES - UNIT_COUNT ) * sizeof( uint16_t ) );
+  }
+}
+
+// unit values seen by columns 0-7 of a row, the ninth column is left to the caller
+static inline __m128i rowUsedDigits( const Board &board, int row, __m128i cols ) {
+  int box = ( row / BOX_SIZE ) * BOX_SIZE;
+  const uint16_t *boxes = board.unitValues + Board::boxUnit( box );
+  __m128i boxValues = _mm_setr_epi16( boxes[ 0 ], boxes[ 0 ], boxes[ 0 ], boxes[ 1 ], boxes[ 1 ], boxes[ 1 ], boxes[ 2 ],
+                                      boxes[ 2 ] );
+  __m128i rowValues = _mm_set1_epi16( board.unitValues[ Board::rowUnit( row ) ] );
+  return _mm_or_si128( _mm_or_si128( cols, boxValues ), rowValues );
+}
+
+static inline void recomputeLastColumn( Board &board, int row ) {
+  int cell = row * GRID_SIZE + GRID_SIZE - 1;
+  board.candidates[ cell ] &= ~usedDigits( board, cell );
+}
+
+static void countUnitCandidatesSse2( const Board &board, uint16_t once[ UNIT_COUNT ], uint16_t twice[ UNIT_COUNT ] ) {
+  UnitLanes units;
+  transposeUnits( board, units );
+
+  __m128i seen[ 4 ], seenTwice[ 4 ];
+  for ( int i = 0; i < 4; i++ ) {
+    seen[ i ] = _mm_setzero_si128();
+    seenTwice[ i ] = _mm_setzero_si128();
+  }
+  for ( int k = 0; k < GRID_SIZE; k++ ) {
+    for ( int i = 0; i < 4; i++ ) {
+      __m128i lanes = _mm_load_si128( reinterpret_cast<const __m128i *>( units.lanes[ k ] + i * 8 ) );
+      seenTwice[ i ] = _mm_or_si128( seenTwice[ i ], _mm_and_si128( seen[ i ], lanes ) );
+      seen[ i ] = _mm_or_si128( seen[ i ], lanes );
+    }
+  }
+
+  alignas( 16 ) uint16_t outOnce[ UNIT_LANES ], outTwice[ UNIT_LANES ];
+  for ( int i = 0; i < 4; i++ ) {
+    _mm_store_si128( reinterpret_cast<__m128i *>( outOnce + i * 8 ), seen[ i ] );
+    _mm_store_si128( reinterpret_cast<__m128i *>( outTwice + i * 8 ), seenTwice[ i ] );
+  }
+  std::memcpy( once, outOnce, UNIT_COUNT * sizeof( uint16_t ) );
+  std::memcpy( twice, outTwice, UNIT_COUNT * sizeof( uint16_t ) );
+}
+
+static void recomputeCandidatesSse2( Board &board ) {
+  __m128i cols = _mm_loadu_si128( reinterpret_cast<const __m128i *>( board.unitValues + Board::colUnit( 0 ) ) );
+  for ( int row = 0; row < GRID_SIZE; row++ ) {
+    __m128i *cells = reinterpret_cast<__m128i *>( board.candidates + row * GRID_SIZE );
+    _mm_storeu_si128( cells, _mm_andnot_si128( rowUsedDigits( board, row, cols ), _mm_loadu_si128( cells ) ) );
+    recomputeLastColumn( board, row );
+  }
+}
+
+__attribute__( ( target( "avx2" ) ) ) static void
+countUnitCandidatesAvx2( const Board &board, uint16_t once[ UNIT_COUNT ], uint16_t twice[ UNIT_COUNT ] ) {
+  UnitLanes units;
+  transposeUnits( board, units );
+
+  __m256i seen0 = _mm256_setzero_si256(), seen1 = _mm256_setzero_si256();
+  __m256i seenTwice0 = _mm256_setzero_si256(), seenTwice1 = _mm256_setzero_si256();
+  for ( int k = 0; k < GRID_SIZE; k++ ) {
+    __m256i lanes0 = _mm256_load_si256( reinterpret_cast<const __m256i *>( units.lanes[ k ] ) );
+    __m256i lanes1 = _mm256_load_si256( reinterpret_cast<const __m256i *>( units.lanes[ k ] + 16 ) );
+    seenTwice0 = _mm256_or_si256( seenTwice0, _mm256_and_si256( seen0, lanes0 ) );
+    seenTwice1 = _mm256_or_si256( seenTwice1, _mm256_and_si256( seen1, lanes1 ) );
+    seen0 = _mm256_or_si256( seen0, lanes0 );
+    seen1 = _mm256_or_si256( seen1, lanes1 );
+  }
+
+  alignas( 32 ) uint16_t outOnce[ UNIT_LANES ], outTwice[ UNIT_LANES ];
+  _mm256_store_si256( reinterpret_cast<__m256i *>( outOnce ), seen0 );
+  _mm256_store_si256( reinterpret_cast<__m256i *>( outOnce + 16 ), seen1 );
+  _mm256_store_si256( reinterpret_cast<__m256i *>( outTwice ), seenTwice0 );
+  _mm256_store_si256( reinterpret_cast<__m256i *>( outTwice + 16 ), seenTwice1 );
+  std::memcpy( once, outOnce, UNIT_COUNT * sizeof( uint16_t ) );
+  std::memcpy( twice, outTwice, UNIT_COUNT * sizeof( uint16_t ) );
+}
+
+// two rows per 256-bit op, the last row falls back to 128 bits
+__attribute__( ( target( "avx2" ) ) ) static void recomputeCandidatesAvx2( Board &board ) {
+  __m128i cols = _mm_loadu_si128( reinterpret_cast<const __m128i *>( board.unitValues + Board::colUnit( 0 ) ) );
+  for ( int row = 0; row + 1 < GRID_SIZE; row += 2 ) {
+    __m128i *low = reinterpret_cast<__m128i *>( board.candidates + row * GRID_SIZE );
+    __m128i *high = reinterpret_cast<__m128i *>( board.candidates + ( row + 1 ) * GRID_SIZE );
+    __m256i used = _mm256_set_m128i( rowUsedDigits( board, row + 1, cols ), rowUsedDigits( board, row, cols ) );
+    __m256i cells = _mm256_set_m128i( _mm_loadu_si128( high ), _mm_loadu_si128( low ) );
+    cells = _mm256_andnot_si256( used, cells );
+    _mm_storeu_si128( low, _mm256_castsi256_si128( cells ) );
+    _mm_storeu_si128( high, _mm256_extracti128_si256( cells, 1 ) );
+    recomputeLastColumn( board, row );
+    recomputeLastColumn( board, row + 1 );
+  }
+
+  int row = GRID_SIZE - 1;
+  __m128i *cells = reinterpret_cast<__m128i *>( board.candidates + row * GRID_SIZE );
+  _mm_storeu_si128( cells, _mm_andnot_si128( rowUsedDigits( board, row, cols ), _mm_loadu_si128( cells ) ) );
+  recomputeLastColumn( board, row );
+}
+
+#endif
+
+struct Kernels {
+  const char *name;
+  void ( *countUnitCandidates )( const Board &, uint16_t *, uint16_t * );
+  void ( *recomputeCandidates )( Board & );
+};
+
+static Kernels selectKernels() {
+  const char *forced = std::getenv( "SUDOKU_KERNELS" );
+  std::string wanted = forced ? forced : "";
+#ifdef HAVE_X86_KERNELS
+  __builtin_cpu_init();
+  if ( ( wanted.empty() || wanted == "avx2" ) && __builtin_cpu_supports( "avx2" ) )
+    return { "avx2", countUnitCandidatesAvx2, recomputeCandidatesAvx2 };
+  if ( wanted != "scalar" )
+    return { "sse2", countUnitCandidatesSse2, recomputeCandidatesSse2 };
+#endif
+  return { "scalar", countUnitCandidatesScalar<3>, recomputeCandidatesScalar<3> };
+}
+
+static const Kernels kernels = selectKernels();
+
+template <int N>
+void countUnitCandidates( const BasicBoard<N> &board, typename BasicBoard<N>::Mask once[],
+                          typename BasicBoard<N>::Mask twice[] ) {
+  countUnitCandidatesScalar( board, once, twice );
+}
+
+template <> void countUnitCandidates<3>( const Board &board, uint16_t once[], uint16_t twice[] ) {
+  kernels.countUnitCandidates( board, once, twice );
+}
+
+template <int N>
+void countQueuedUnitCandidates( const BasicBoard<N> &board, typename BasicBoard<N>::UnitMask units,
+                                typename BasicBoard<N>::Mask once[], typename BasicBoard<N>::Mask twice[] ) {
+  // only the 9x9 board has a full pass that is faster than its units one by one
+  if ( N == 3 && unitCount( units ) >= KERNEL_UNIT_THRESHOLD ) {
+    countUnitCandidates( board, once, twice );
+    return;
+  }
+  while ( units ) {
+    int unit = lowestUnit( units );
+    units &= units - 1;
+    countUnit( board, unit, once[ unit ], twice[ unit ] );
+  }
+}
+
+template <int N> void recomputeCandidates( BasicBoard<N> &board ) { recomputeCandidatesScalar( board ); }
+
+template <> void recomputeCandidates<3>( Board &board ) { kernels.recomputeCandidates( board ); }
+
+const char *kernelName() { return kernels.name; }
+
+#define INSTANTIATE_KERNELS( N )                                                                                       \
+  template void countQueuedUnitCandidates( const BasicBoard<N> &, BasicBoard<N>::UnitMask, BasicBoard<N>::Mask[],      \
+                                           BasicBoard<N>::Mask[] );
+
+INSTANTIATE_KERNELS( 3 )
+INSTANTIATE_KERNELS( 4 )
+INSTANTIATE_KERNELS( 5 )
+template void countUnitCandidates( const BasicBoard<4> &, uint16_t[], uint16_t[] );
+template void countUnitCandidates( const BasicBoard<5> &, uint32_t[], uint32_t[] );
+template void recomputeCandidates( BasicBoard<4> & );
+template void recomputeCandidates( BasicBoard<5> & );
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "board.h"
+
+// Unit-wide bitmask kernels. The 9x9 board has AVX2 and SSE2 versions next to the scalar
+// one; the widest version the CPU supports is picked once at startup and
+// SUDOKU_KERNELS=scalar, sse2 or avx2 in the environment overrides the choice. Larger
+// boards use the scalar versions.
+
+// once[ unit ] holds the digits that are a candidate in at least one cell of the unit,
+// twice[ unit ] those that are a candidate in more than one
+template <int N>
+void countUnitCandidates( const BasicBoard<N> &board, typename BasicBoard<N>::Mask once[],
+                          typename BasicBoard<N>::Mask twice[] );
+// the same for the units set in the units bitmask only; other entries are left alone
+template <int N>
+void countQueuedUnitCandidates( const BasicBoard<N> &board, typename BasicBoard<N>::UnitMask units,
+                                typename BasicBoard<N>::Mask once[], typename BasicBoard<N>::Mask twice[] );
+// drop every candidate already placed in one of the cell's units
+template <int N> void recomputeCandidates( BasicBoard<N> &board );
+
+template <> void countUnitCandidates<3>( const Board &board, uint16_t once[], uint16_t twice[] );
+template <> void recomputeCandidates<3>( Board &board );
+
+const char *kernelName();
@@ -0,0 +1,169 @@
+#include "lanes.h"
+#include "kernels.h"
+#include <cstring>
+
+#if defined( __x86_64__ )
+#define HAVE_X86_LANES 1
+#endif
+
+// one 16-bit candidate mask per lane; plain GCC vectors, so the same code builds for SSE2
+// as two 128-bit halves and for AVX2 as one 256-bit register
+typedef uint16_t Lanes __attribute__( ( vector_size( 2 * LANE_COUNT ) ) );
+
+struct alignas( 32 ) LaneBoards {
+  Lanes candidates[ Board::CELL_COUNT ];
+  // all ones in the lanes where the cell is down to one candidate that is already gone
+  // from its peers
+  Lanes done[ Board::CELL_COUNT ];
+  // set by each round: all ones in the lanes it changed anything in
+  Lanes changed;
+};
+
+static inline __attribute__( ( always_inline ) ) bool anyLane( const Lanes &lanes ) {
+  uint64_t words[ sizeof( Lanes ) / 8 ];
+  std::memcpy( words, &lanes, sizeof( lanes ) );
+  uint64_t any = 0;
+  for ( uint64_t word : words ) {
+    any |= word;
+  }
+  return any != 0;
+}
+
+// One pass of naked then hidden singles over every lane. Inlined into each target below so
+// the vector code is compiled for that target; vectors never cross a call, so the AVX2 and
+// generic builds don't need to agree on how to pass them.
+static inline __attribute__( ( always_inline ) ) void singlesRoundBody( LaneBoards &boards ) {
+  Lanes changed = {};
+  for ( int cell = 0; cell < Board::CELL_COUNT; cell++ ) {
+    Lanes candidates = boards.candidates[ cell ];
+    Lanes single = (Lanes)( ( candidates & ( candidates - 1 ) ) == 0 ) & (Lanes)( candidates != 0 ) &
+                   ~boards.done[ cell ];
+    if ( !anyLane( single ) )
+      continue;
+    boards.done[ cell ] |= single;
+    changed |= single;
+    Lanes placed = ~( candidates & single );
+    for ( int peer : boardTables<3>.peers[ cell ] ) {
+      boards.candidates[ peer ] &= placed;
+    }
+  }
+
+  for ( const auto &cells : boardTables<3>.unitCells ) {
+    Lanes once = {}, twice = {};
+    for ( int cell : cells ) {
+      twice |= once & boards.candidates[ cell ];
+      once |= boards.candidates[ cell ];
+    }
+    Lanes exactlyOnce = once & ~twice;
+    for ( int cell : cells ) {
+      Lanes candidates = boards.candidates[ cell ];
+      Lanes hidden = candidates & exactlyOnce;
+      Lanes take = (Lanes)( hidden != 0 ) & (Lanes)( hidden != candidates );
+      boards.candidates[ cell ] = ( hidden & take ) | ( candidates & ~take );
+      changed |= take;
+    }
+  }
+  boards.changed = changed;
+}
+
+static void singlesRound( LaneBoards &boards ) { singlesRoundBody( boards ); }
+
+#ifdef HAVE_X86_LANES
+__attribute__( ( target( "avx2" ) ) ) static void singlesRoundAvx2( LaneBoards &boards ) {
+  singlesRoundBody( boards );
+}
+#endif
+
+using SinglesRound = void ( * )( LaneBoards & );
+
+// follows the kernel choice, so SUDOKU_KERNELS applies here too
+static SinglesRound selectRound() {
+#ifdef HAVE_X86_LANES
+  if ( std::strcmp( kernelName(), "avx2" ) == 0 )
+    return singlesRoundAvx2;
+#endif
+  return singlesRound;
+}
+
+// picked on first use: a namespace-scope static could run before kernels.cpp's and read
+// a kernel name that isn't set yet
+static SinglesRound runRound() {
+  static const SinglesRound round = selectRound();
+  return round;
+}
+
+// an empty lane has no candidates and nothing left to do, so it never changes
+static void clearLane( LaneBoards &boards, int lane ) {
+  for ( int cell = 0; cell < Board::CELL_COUNT; cell++ ) {
+    boards.candidates[ cell ][ lane ] = 0;
+    boards.done[ cell ][ lane ] = 0xffff;
+  }
+}
+
+// placed digits become single candidates whose peers are already clear of them
+static void loadLane( LaneBoards &boards, int lane, const Board &board ) {
+  for ( int cell = 0; cell < Board::CELL_COUNT; cell++ ) {
+    int num = board.values[ cell ];
+    boards.candidates[ cell ][ lane ] = num ? digitBit( num ) : board.candidates[ cell ];
+    boards.done[ cell ][ lane ] = num ? 0xffff : 0;
+  }
+}
+
+// Hands the lane back as a board the cascade carries on from: singles become placed
+// digits and every other cell keeps the candidates the lanes left it, so nothing is
+// recomputed. Since the lane has stopped changing every single has been cleared from its
+// peers and no unit has a hidden one, so the singles' queues start out empty. True if
+// every cell is placed; a full board is then a valid one.
+static bool storeLane( const LaneBoards &boards, int lane, Board &board ) {
+  Board stored = {};
+  bool complete = true;
+  for ( int cell = 0; cell < Board::CELL_COUNT; cell++ ) {
+    uint16_t candidates = boards.candidates[ cell ][ lane ];
+    if ( candidates == 0 )
+      return false;
+    if ( candidates & ( candidates - 1 ) ) {
+      stored.candidates[ cell ] = candidates;
+      complete = false;
+      continue;
+    }
+    stored.values[ cell ] = __builtin_ctz( candidates ) + 1;
+    for ( uint8_t unit : boardTables<3>.cellUnits[ cell ] ) {
+      stored.unitValues[ unit ] |= candidates;
+    }
+  }
+  board = stored;
+  return complete;
+}
+
+void solveSinglesInLanes( Board *const boards[], size_t count, bool solved[] ) {
+  LaneBoards lanes;
+  long slots[ LANE_COUNT ];
+  size_t next = 0;
+  int active = 0;
+  for ( int lane = 0; lane < LANE_COUNT; lane++ ) {
+    slots[ lane ] = next < count ? static_cast<long>( next++ ) : -1;
+    if ( slots[ lane ] < 0 ) {
+      clearLane( lanes, lane );
+      continue;
+    }
+    loadLane( lanes, lane, *boards[ slots[ lane ] ] );
+    active++;
+  }
+
+  while ( active > 0 ) {
+    runRound()( lanes );
+    for ( int lane = 0; lane < LANE_COUNT; lane++ ) {
+      if ( slots[ lane ] < 0 || lanes.changed[ lane ] )
+        continue;
+      solved[ slots[ lane ] ] = storeLane( lanes, lane, *boards[ slots[ lane ] ] );
+      if ( next < count ) {
+        slots[ lane ] = next++;
+        loadLane( lanes, lane, *boards[ slots[ lane ] ] );
+      } else {
+        slots[ lane ] = -1;
+        clearLane( lanes, lane );
+        active--;
+      }
+    }
+  }
+}
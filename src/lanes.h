@@ -0,0 +1,16 @@
+#pragma once
+
+#include "board.h"
+#include <cstddef>
+
+// 9x9 boards solved one per SIMD lane: 16 boards' candidate masks sit side by side, one
+// 16-bit lane each, and naked and hidden singles run over all of them in lock step. A
+// lane whose board stops changing is retired and refilled with the next board, so the
+// lanes stay busy until the input runs out. Singles alone finish most easy and medium
+// boards; the rest come back with the singles' progress applied for the scalar cascade.
+#define LANE_COUNT 16
+
+// solves *boards[ 0, count ) in place and sets solved[ i ] if singles alone finished
+// board i; unfinished boards are left as far as singles got them, or untouched if the
+// singles ran into a contradiction
+void solveSinglesInLanes( Board *const boards[], size_t count, bool solved[] );
@@ -0,0 +1,298 @@
+#include "lineio.h"
+#include "corpus.h"
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile() {
+  if ( bytes )
+    munmap( const_cast<char *>( bytes ), length );
+}
+
+bool MappedFile::open( const std::string &path, bool sequential ) {
+  int fd = ::open( path.c_str(), O_RDONLY );
+  if ( fd < 0 )
+    return false;
+
+  struct stat info;
+  if ( fstat( fd, &info ) != 0 ) {
+    close( fd );
+    return false;
+  }
+  length = info.st_size;
+  if ( length == 0 ) {
+    close( fd );
+    return true;
+  }
+
+  void *mapped = mmap( nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd );
+  if ( mapped == MAP_FAILED ) {
+    length = 0;
+    return false;
+  }
+  madvise( mapped, length, sequential ? MADV_SEQUENTIAL : MADV_RANDOM );
+  bytes = static_cast<const char *>( mapped );
+  return true;
+}
+
+void MappedFile::release( size_t offset ) {
+  size_t page = sysconf( _SC_PAGESIZE );
+  size_t end = offset / page * page;
+  if ( end > released ) {
+    madvise( const_cast<char *>( bytes ) + released, end - released, MADV_DONTNEED );
+    released = end;
+  }
+}
+
+BufferedWriter::BufferedWriter( int fd, size_t capacity )
+    : fd( fd ), buffer( new char[ capacity ] ), capacity( capacity ) {}
+
+BufferedWriter::~BufferedWriter() {
+  flush();
+  if ( ownsFd )
+    close( fd );
+  delete[] buffer;
+}
+
+std::unique_ptr<BufferedWriter> BufferedWriter::open( const std::string &path ) {
+  if ( path == "-" )
+    return std::make_unique<BufferedWriter>( STDOUT_FILENO );
+  int fd = ::open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+  if ( fd < 0 )
+    return nullptr;
+  auto writer = std::make_unique<BufferedWriter>( fd );
+  writer->ownsFd = true;
+  return writer;
+}
+
+void BufferedWriter::write( const char *data, size_t size ) {
+  if ( used + size > capacity )
+    flush();
+  if ( size > capacity ) {
+    // too big to buffer, write it straight through
+    while ( size > 0 && !failed ) {
+      ssize_t written = ::write( fd, data, size );
+      if ( written <= 0 ) {
+        failed = true;
+        break;
+      }
+      data += written;
+      size -= written;
+    }
+    return;
+  }
+  std::memcpy( buffer + used, data, size );
+  used += size;
+}
+
+bool BufferedWriter::flush() {
+  size_t offset = 0;
+  while ( offset < used && !failed ) {
+    ssize_t written = ::write( fd, buffer + offset, used - offset );
+    if ( written <= 0 ) {
+      failed = true;
+      break;
+    }
+    offset += written;
+  }
+  used = 0;
+  return !failed;
+}
+
+size_t nextLine( const char *data, size_t size, size_t &offset ) {
+  const char *start = data + offset;
+  const char *end = static_cast<const char *>( std::memchr( start, '\n', size - offset ) );
+  size_t length = end ? end - start : size - offset;
+  offset += end ? length + 1 : length;
+  if ( length > 0 && start[ length - 1 ] == '\r' )
+    length--;
+  return length;
+}
+
+// the digit a cell character stands for, 0 for a blank and -1 if it isn't a cell character
+static inline int cellDigit( char c ) {
+  if ( c == '.' || ( c >= '0' && c <= '9' ) )
+    return c == '.' ? 0 : c - '0';
+  if ( c >= 'A' && c <= 'P' )
+    return c - 'A' + 10;
+  if ( c >= 'a' && c <= 'p' )
+    return c - 'a' + 10;
+  return -1;
+}
+
+static inline char digitChar( int num ) { return num == 0 ? '.' : num <= 9 ? '0' + num : 'A' + num - 10; }
+
+template <int N> static bool parseDigits( const char *line, uint8_t values[] ) {
+  for ( int cell = 0; cell < BasicBoard<N>::CELL_COUNT; cell++ ) {
+    int num = cellDigit( line[ cell ] );
+    if ( num < 0 || num > BasicBoard<N>::GRID_SIZE )
+      return false;
+    values[ cell ] = num;
+  }
+  return true;
+}
+
+int lineBoxSize( const char *line, size_t length ) {
+  size_t cells = 0;
+  while ( cells < length && cellDigit( line[ cells ] ) >= 0 )
+    cells++;
+  switch ( cells ) {
+  case 81:
+    return 3;
+  case 256:
+    return 4;
+  case 625:
+    return 5;
+  default:
+    return 0;
+  }
+}
+
+template <int N> bool parseLineBoard( const char *line, size_t length, BasicBoard<N> &board ) {
+  constexpr size_t cells = BasicBoard<N>::CELL_COUNT;
+  uint8_t values[ cells ];
+  if ( length < cells || !parseDigits<N>( line, values ) )
+    return false;
+  if ( length > cells && cellDigit( line[ cells ] ) >= 0 )
+    return false;
+  board = boardFromValues<N>( values );
+  return true;
+}
+
+template <int N> bool parseLineSolution( const char *line, size_t length, BasicBoard<N> &solution ) {
+  constexpr size_t cells = BasicBoard<N>::CELL_COUNT;
+  uint8_t values[ cells ];
+  if ( length < 2 * cells + 1 || !parseDigits<N>( line + cells + 1, values ) )
+    return false;
+  solution = boardFromValues<N>( values );
+  return true;
+}
+
+template <int N> void formatLineBoard( const BasicBoard<N> &board, char *out ) {
+  for ( int cell = 0; cell < BasicBoard<N>::CELL_COUNT; cell++ ) {
+    out[ cell ] = digitChar( board.values[ cell ] );
+  }
+}
+
+#define INSTANTIATE_LINEIO( N )                                                                                        \
+  template bool parseLineBoard( const char *, size_t, BasicBoard<N> & );                                               \
+  template bool parseLineSolution( const char *, size_t, BasicBoard<N> & );                                            \
+  template void formatLineBoard( const BasicBoard<N> &, char * );
+
+INSTANTIATE_LINEIO( 3 )
+INSTANTIATE_LINEIO( 4 )
+INSTANTIATE_LINEIO( 5 )
+
+bool isJsonPath( const std::string &path ) {
+  return path.size() >= 5 && path.compare( path.size() - 5, 5, ".json" ) == 0;
+}
+
+// puzzle,solution,difficulty per line
+static int jsonToLines( const std::string &inPath, const std::string &outPath ) {
+  std::ifstream in( inPath );
+  const json boards = json::parse( in );
+  in.close();
+
+  std::unique_ptr<BufferedWriter> out = BufferedWriter::open( outPath );
+  if ( !out ) {
+    std::cerr << "failed to open " << outPath << std::endl;
+    return 1;
+  }
+  for ( const json &board : boards ) {
+    const json &value = board.at( "value" );
+    withBoxSize( jsonBoxSize( value ), [ & ]( auto size ) {
+      constexpr int N = decltype( size )::value;
+      formatLineBoard( boardFromJson<N>( value ), out->reserve( BasicBoard<N>::CELL_COUNT ) );
+      if ( board.contains( "solution" ) ) {
+        out->put( ',' );
+        formatLineBoard( boardFromJson<N>( board.at( "solution" ) ), out->reserve( BasicBoard<N>::CELL_COUNT ) );
+      }
+    } );
+    if ( board.contains( "solution" ) && board.contains( "difficulty" ) ) {
+      std::string difficulty = board.at( "difficulty" );
+      out->put( ',' );
+      out->write( difficulty.data(), difficulty.size() );
+    }
+    out->put( '\n' );
+  }
+  return out->flush() ? 0 : 1;
+}
+
+static int linesToJson( const std::string &inPath, const std::string &outPath ) {
+  MappedFile file;
+  if ( !file.open( inPath ) ) {
+    std::cerr << "failed to open " << inPath << std::endl;
+    return 1;
+  }
+
+  std::unique_ptr<BufferedWriter> out = BufferedWriter::open( outPath );
+  if ( !out ) {
+    std::cerr << "failed to open " << outPath << std::endl;
+    return 1;
+  }
+
+  // written one board at a time so the output never has to fit in memory as a DOM
+  size_t offset = 0;
+  bool first = true;
+  out->write( "[\n", 2 );
+  while ( offset < file.size() ) {
+    const char *line = file.data() + offset;
+    size_t length = nextLine( file.data(), file.size(), offset );
+    int boxSize = lineBoxSize( line, length );
+    if ( boxSize == 0 )
+      continue;
+
+    json entry = withBoxSize( boxSize, [ & ]( auto size ) {
+      constexpr int N = decltype( size )::value;
+      constexpr size_t cells = BasicBoard<N>::CELL_COUNT;
+      BasicBoard<N> board, solution;
+      if ( !parseLineBoard( line, length, board ) )
+        return json();
+      json entry = { { "value", boardToJson( board ) } };
+      if ( parseLineSolution( line, length, solution ) ) {
+        entry[ "solution" ] = boardToJson( solution );
+        if ( length > 2 * cells + 2 )
+          entry[ "difficulty" ] = std::string( line + 2 * cells + 2, length - 2 * cells - 2 );
+      }
+      return entry;
+    } );
+    // a line with a digit too big for its board is left out, as batch skips it
+    if ( entry.is_null() )
+      continue;
+    std::string text = entry.dump();
+    if ( !first )
+      out->write( "  ,\n", 4 );
+    out->write( "  ", 2 );
+    out->write( text.data(), text.size() );
+    out->put( '\n' );
+    first = false;
+    file.release( offset );
+  }
+  out->write( "]\n", 2 );
+  return out->flush() ? 0 : 1;
+}
+
+int runConvert( int argc, char **argv ) {
+  if ( argc != 2 ) {
+    std::cerr << "usage: sudoku convert <in> <out>" << std::endl;
+    return 2;
+  }
+
+  try {
+    if ( isCorpusPath( argv[ 1 ] ) )
+      return packCorpus( argv[ 0 ], argv[ 1 ] );
+    if ( isCorpusPath( argv[ 0 ] ) )
+      return unpackCorpus( argv[ 0 ], argv[ 1 ] );
+    if ( isJsonPath( argv[ 0 ] ) )
+      return jsonToLines( argv[ 0 ], argv[ 1 ] );
+    return linesToJson( argv[ 0 ], argv[ 1 ] );
+  } catch ( const std::exception &e ) {
+    std::cerr << "failed to convert " << argv[ 0 ] << ": " << e.what() << std::endl;
+    return 1;
+  }
+}
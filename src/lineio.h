@@ -0,0 +1,90 @@
+#pragma once
+
+#include "board.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// One puzzle per line: one character per cell (81, 256 or 625 of them), 1-9 then A-P for
+// clues and 0 or . for blanks, optionally followed by a separator and the solution in the
+// same format (and anything after that).
+
+// Read-only memory map of a whole file. Pages are only touched as they are read and
+// can be handed back with release(), so resident memory doesn't grow with file size.
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile( const MappedFile & ) = delete;
+  MappedFile &operator=( const MappedFile & ) = delete;
+
+  // sequential maps read ahead aggressively, random ones only fault in the pages touched
+  bool open( const std::string &path, bool sequential = true );
+  // drop the pages before offset, they won't be read again
+  void release( size_t offset );
+
+  const char *data() const { return bytes; }
+  size_t size() const { return length; }
+
+private:
+  const char *bytes = nullptr;
+  size_t length = 0;
+  size_t released = 0;
+};
+
+// Large-buffer writer on a file descriptor; one write() per buffer instead of per line.
+class BufferedWriter {
+public:
+  explicit BufferedWriter( int fd, size_t capacity = 1 << 20 );
+  ~BufferedWriter();
+
+  BufferedWriter( const BufferedWriter & ) = delete;
+  BufferedWriter &operator=( const BufferedWriter & ) = delete;
+
+  // "-" is stdout
+  static std::unique_ptr<BufferedWriter> open( const std::string &path );
+
+  void write( const char *data, size_t size );
+  void put( char c ) {
+    if ( used == capacity )
+      flush();
+    buffer[ used++ ] = c;
+  }
+  // reserve size bytes to format into directly, size must not exceed the capacity
+  char *reserve( size_t size ) {
+    if ( used + size > capacity )
+      flush();
+    char *out = buffer + used;
+    used += size;
+    return out;
+  }
+  bool flush();
+  bool ok() const { return !failed; }
+
+private:
+  int fd;
+  bool ownsFd = false;
+  bool failed = false;
+  char *buffer;
+  size_t capacity;
+  size_t used = 0;
+};
+
+// the next line starting at offset; returns its length without the line ending and moves offset past it
+size_t nextLine( const char *data, size_t size, size_t &offset );
+
+// box size of the board the line starts with, 0 if it doesn't start with one
+int lineBoxSize( const char *line, size_t length );
+// false if the line doesn't start with a well formed board of this size
+template <int N> bool parseLineBoard( const char *line, size_t length, BasicBoard<N> &board );
+// true if the line carries a solution after the board
+template <int N> bool parseLineSolution( const char *line, size_t length, BasicBoard<N> &solution );
+// writes BasicBoard<N>::CELL_COUNT characters
+template <int N> void formatLineBoard( const BasicBoard<N> &board, char *out );
+
+bool isJsonPath( const std::string &path );
+
+// converts between boards.json, the line format and packed corpora, direction picked by the
+// .json and .corpus extensions
+int runConvert( int argc, char **argv );
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "board.h"
+#include "budget.h"
+#include "solver.h"
+#include "stats.h"
+#include "subsets.h"
+
+// A step cascade is a Pipeline of strategies, tried in the order they're listed. Each
+// strategy is a type with the Technique it counts as and a static apply( board, placements )
+// that reports progress, so a pipeline's step() is one chain of inlined calls: no function
+// pointers, and nothing at all for the techniques a pipeline leaves out.
+
+template <int N> inline void placeAll( BasicBoard<N> &board, const PlacementList<N> &placements ) {
+  for ( int i = 0; i < placements.count; i++ ) {
+    const Placement<N> &placement = placements.items[ i ];
+    placeValue( board, placement.num, placement.cell );
+  }
+}
+
+struct NakedSinglesStrategy {
+  static constexpr Technique technique = NAKED_SINGLES;
+  template <int N> static bool apply( BasicBoard<N> &board, int &placements ) {
+    PlacementList<N> singles;
+    findAllNakedSingles( board, singles );
+    placeAll( board, singles );
+    placements = singles.count;
+    return singles.count > 0;
+  }
+};
+
+struct HiddenSinglesStrategy {
+  static constexpr Technique technique = HIDDEN_SINGLES;
+  template <int N> static bool apply( BasicBoard<N> &board, int &placements ) {
+    PlacementList<N> singles;
+    findAllHiddenSingles( board, singles );
+    placeAll( board, singles );
+    placements = singles.count;
+    return singles.count > 0;
+  }
+};
+
+// the techniques that only remove candidates
+#define ELIMINATION_STRATEGY( Name, TECHNIQUE, function )                                                              \
+  struct Name {                                                                                                        \
+    static constexpr Technique technique = TECHNIQUE;                                                                  \
+    template <int N> static bool apply( BasicBoard<N> &board, int & ) { return function( board ); }                    \
+  };
+
+ELIMINATION_STRATEGY( PointingPairsStrategy, POINTING_PAIRS, applyPointingPairs )
+ELIMINATION_STRATEGY( BoxLineStrategy, BOX_LINE_REDUCTION, reduceBoxLine )
+ELIMINATION_STRATEGY( NakedSubsetsStrategy, NAKED_SUBSETS, nakedSubsets )
+ELIMINATION_STRATEGY( HiddenSubsetsStrategy, HIDDEN_SUBSETS, hiddenSubsets )
+ELIMINATION_STRATEGY( XWingStrategy, X_WING, xWing )
+ELIMINATION_STRATEGY( XYWingStrategy, XY_WING, xyWing )
+ELIMINATION_STRATEGY( SwordfishStrategy, SWORDFISH, swordfish )
+ELIMINATION_STRATEGY( XYZWingStrategy, XYZ_WING, xyzWing )
+ELIMINATION_STRATEGY( JellyfishStrategy, JELLYFISH, jellyfish )
+ELIMINATION_STRATEGY( FinnedFishStrategy, FINNED_FISH, finnedFish )
+
+template <typename... Strategies> struct Pipeline {
+  // applies the first strategy that reports progress and returns its technique
+  template <int N> static Technique step( BasicBoard<N> &board, SolveStats *stats = nullptr ) {
+    TechniqueProbe probe( stats, board );
+    Technique applied = NO_TECHNIQUE;
+    ( tryStrategy<Strategies>( board, probe, applied ) || ... );
+    return applied;
+  }
+
+  // solveLogically with this pipeline's steps
+  template <int N>
+  static bool solve( BasicBoard<N> &board, SolveStats *stats = nullptr, SolveTrace *trace = nullptr,
+                     SolveBudget *budget = nullptr ) {
+    while ( !isSolved( board ) ) {
+      if ( budget && !budget->spend( true ) )
+        return false;
+      BasicBoard<N> before = board;
+      Technique technique = step( board, stats );
+      if ( sameState( before, board ) )
+        return false;
+      if ( trace )
+        trace->push_back( technique );
+    }
+    return true;
+  }
+
+private:
+  template <typename Strategy, int N>
+  static bool tryStrategy( BasicBoard<N> &board, TechniqueProbe<N> &probe, Technique &applied ) {
+    int placements = 0;
+    probe.begin();
+    bool changed = Strategy::apply( board, placements );
+    probe.end( Strategy::technique, changed, placements );
+    if ( changed )
+      applied = Strategy::technique;
+    return changed;
+  }
+};
+
+// Presets. Singles leave the rest to search, which on 9x9 is the fastest way through a
+// batch; basic adds the intersections and subsets; human is the whole ladder in cascade
+// order, what grades, the generator and the viewer use.
+using SinglesPipeline = Pipeline<NakedSinglesStrategy, HiddenSinglesStrategy>;
+using BasicPipeline = Pipeline<NakedSinglesStrategy, HiddenSinglesStrategy, PointingPairsStrategy, BoxLineStrategy,
+                               NakedSubsetsStrategy, HiddenSubsetsStrategy>;
+using HumanPipeline =
+    Pipeline<NakedSinglesStrategy, HiddenSinglesStrategy, PointingPairsStrategy, BoxLineStrategy, NakedSubsetsStrategy,
+             HiddenSubsetsStrategy, XWingStrategy, XYWingStrategy, SwordfishStrategy, XYZWingStrategy,
+             JellyfishStrategy, FinnedFishStrategy>;
+
+// calls fn( pipeline ) with a value of the preset's Pipeline type, so the choice is made
+// once and everything under it is compiled for that pipeline; ADAPTIVE_PIPELINE isn't a
+// Pipeline, callers pick up an AdaptiveScheduler for it themselves
+template <typename Fn> decltype( auto ) withPipeline( int preset, Fn &&fn ) {
+  switch ( preset ) {
+  case SINGLES_PIPELINE:
+    return fn( SinglesPipeline() );
+  case BASIC_PIPELINE:
+    return fn( BasicPipeline() );
+  default:
+    return fn( HumanPipeline() );
+  }
+}
@@ -0,0 +1,107 @@
+#include "pool.h"
+#include <algorithm>
+
+// the pool the calling thread works for, if any, and its index there
+static thread_local const ThreadPool *workerPool = nullptr;
+static thread_local int workerIndex = -1;
+
+ThreadPool::ThreadPool( unsigned threadCount ) {
+  threadCount = std::max( 1u, threadCount );
+  for ( unsigned i = 0; i < threadCount; i++ ) {
+    workers.push_back( std::make_unique<Worker>() );
+  }
+  for ( unsigned i = 0; i < threadCount; i++ ) {
+    threads.emplace_back( &ThreadPool::run, this, i );
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock( idleMutex );
+    stopping = true;
+  }
+  idle.notify_all();
+  for ( std::thread &thread : threads ) {
+    thread.join();
+  }
+}
+
+int ThreadPool::currentWorker() const { return workerPool == this ? workerIndex : -1; }
+
+void ThreadPool::submit( std::function<void()> task ) {
+  int worker = currentWorker();
+  unsigned index = worker >= 0 ? worker : nextWorker++ % workers.size();
+  pending++;
+  {
+    std::lock_guard<std::mutex> lock( workers[ index ]->mutex );
+    workers[ index ]->tasks.push_back( std::move( task ) );
+    queued++;
+  }
+  {
+    // taking the lock orders the push before a sleeping worker re-checks for work
+    std::lock_guard<std::mutex> lock( idleMutex );
+  }
+  idle.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock( idleMutex );
+  done.wait( lock, [ this ] { return pending == 0; } );
+}
+
+void ThreadPool::parallelFor( size_t count, size_t grain,
+                              const std::function<void( size_t, size_t, unsigned )> &task ) {
+  grain = std::max<size_t>( 1, grain );
+  for ( size_t begin = 0; begin < count; begin += grain ) {
+    size_t end = std::min( count, begin + grain );
+    submit( [ &task, begin, end ] { task( begin, end, workerIndex ); } );
+  }
+  wait();
+}
+
+bool ThreadPool::popTask( unsigned index, std::function<void()> &task ) {
+  Worker &worker = *workers[ index ];
+  std::lock_guard<std::mutex> lock( worker.mutex );
+  if ( worker.tasks.empty() )
+    return false;
+  task = std::move( worker.tasks.back() );
+  worker.tasks.pop_back();
+  queued--;
+  return true;
+}
+
+bool ThreadPool::stealTask( unsigned index, std::function<void()> &task ) {
+  for ( size_t i = 1; i < workers.size(); i++ ) {
+    Worker &victim = *workers[ ( index + i ) % workers.size() ];
+    std::lock_guard<std::mutex> lock( victim.mutex );
+    if ( !victim.tasks.empty() ) {
+      task = std::move( victim.tasks.front() );
+      victim.tasks.pop_front();
+      queued--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::run( unsigned index ) {
+  workerPool = this;
+  workerIndex = index;
+  std::function<void()> task;
+  while ( 1 ) {
+    if ( popTask( index, task ) || stealTask( index, task ) ) {
+      task();
+      task = nullptr;
+      if ( --pending == 0 ) {
+        std::lock_guard<std::mutex> lock( idleMutex );
+        done.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock( idleMutex );
+    idle.wait( lock, [ this ] { return stopping || queued > 0; } );
+    if ( stopping && queued == 0 )
+      return;
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, each with its own task deque. A worker pops the newest
+// task from its own deque and, when that runs dry, steals the oldest task from another
+// worker, so a few expensive tasks never leave the other cores idle.
+class ThreadPool {
+public:
+  explicit ThreadPool( unsigned threadCount = std::thread::hardware_concurrency() );
+  ~ThreadPool();
+
+  ThreadPool( const ThreadPool & ) = delete;
+  ThreadPool &operator=( const ThreadPool & ) = delete;
+
+  // from one of this pool's workers the task goes on that worker's deque, otherwise deques
+  // are filled round-robin
+  void submit( std::function<void()> task );
+  // blocks until every submitted task has finished; not to be called from a worker
+  void wait();
+
+  // runs task( begin, end, worker ) over [0, count) in chunks of at most grain
+  void parallelFor( size_t count, size_t grain, const std::function<void( size_t, size_t, unsigned )> &task );
+
+  unsigned size() const { return workers.size(); }
+  // index of the calling worker, -1 when called from outside this pool, a thread of
+  // another pool included
+  int currentWorker() const;
+
+private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void run( unsigned index );
+  bool popTask( unsigned index, std::function<void()> &task );
+  bool stealTask( unsigned index, std::function<void()> &task );
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+  std::atomic<size_t> nextWorker { 0 };
+  std::atomic<size_t> pending { 0 };  // submitted and not yet finished
+  std::atomic<size_t> queued { 0 };   // still sitting in a deque
+  std::mutex idleMutex;
+  std::condition_variable idle;
+  std::condition_variable done;
+  bool stopping = false;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded single-producer single-consumer queue. Each side owns one index and only reads
+// the other's, so neither ever takes a lock; each also caches the last index it saw of
+// the other side and only goes back to the shared one when the cached value says the
+// ring is full (or empty). Capacity must be a power of two.
+template <typename T, size_t Capacity> class SpscRing {
+  static_assert( Capacity > 0 && ( Capacity & ( Capacity - 1 ) ) == 0, "capacity must be a power of two" );
+
+public:
+  // producer only; false when full
+  bool push( const T &item ) {
+    size_t position = tail.load( std::memory_order_relaxed );
+    if ( position - headSeen == Capacity ) {
+      headSeen = head.load( std::memory_order_acquire );
+      if ( position - headSeen == Capacity )
+        return false;
+    }
+    slots[ position & ( Capacity - 1 ) ] = item;
+    tail.store( position + 1, std::memory_order_release );
+    return true;
+  }
+
+  // consumer only; false when empty
+  bool pop( T &item ) {
+    size_t position = head.load( std::memory_order_relaxed );
+    if ( position == tailSeen ) {
+      tailSeen = tail.load( std::memory_order_acquire );
+      if ( position == tailSeen )
+        return false;
+    }
+    item = slots[ position & ( Capacity - 1 ) ];
+    head.store( position + 1, std::memory_order_release );
+    return true;
+  }
+
+private:
+  // consumer side
+  alignas( 64 ) std::atomic<size_t> head { 0 };
+  size_t tailSeen = 0;
+  // producer side
+  alignas( 64 ) std::atomic<size_t> tail { 0 };
+  size_t headSeen = 0;
+  alignas( 64 ) T slots[ Capacity ];
+};
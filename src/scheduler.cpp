@@ -0,0 +1,120 @@
+#include "scheduler.h"
+#include "pipeline.h"
+#include "search.h"
+#include <algorithm>
+
+// the human ladder's strategies, looked up by technique
+template <int N> struct StrategyTable {
+  bool ( *apply[ SEARCH ] )( BasicBoard<N> &, int & ) = {};
+
+  template <typename... Strategies> explicit StrategyTable( Pipeline<Strategies...> ) {
+    ( ( apply[ Strategies::technique ] = &Strategies::template apply<N> ), ... );
+  }
+};
+
+template <int N> static const StrategyTable<N> strategies( HumanPipeline {} );
+
+template <int N> AdaptiveScheduler<N>::AdaptiveScheduler() {
+  for ( int i = 0; i < SEARCH - POINTING_PAIRS; i++ ) {
+    order[ i ] = POINTING_PAIRS + i;
+  }
+}
+
+template <int N> bool AdaptiveScheduler<N>::worthTrying( int technique ) {
+  Learned &counters = learned[ technique ];
+  if ( counters.calls < SCHEDULER_WARMUP || searches == 0 || hitsThisPuzzle[ technique ] )
+    return true;
+  double cost = counters.cycles / counters.calls;
+  double saving = counters.useful / counters.calls * ( searchCycles / searches );
+  if ( cost <= saving )
+    return true;
+  return ++counters.skipped % SCHEDULER_EXPLORE == 0;
+}
+
+// best value first; techniques still warming up keep their place in the cascade ahead of the rest
+template <int N> void AdaptiveScheduler<N>::reorder() {
+  auto value = [ this ]( int technique ) {
+    const Learned &counters = learned[ technique ];
+    if ( counters.calls < SCHEDULER_WARMUP )
+      return 1e300;
+    return counters.useful / std::max( counters.cycles, 1.0 );
+  };
+  std::stable_sort( order, order + ( SEARCH - POINTING_PAIRS ),
+                    [ & ]( int a, int b ) { return value( a ) > value( b ); } );
+}
+
+template <int N> Technique AdaptiveScheduler<N>::step( BasicBoard<N> &board, SolveStats *stats ) {
+  TechniqueProbe probe( stats, board );
+  for ( int i = 0; i < SEARCH; i++ ) {
+    int technique = i < POINTING_PAIRS ? i : order[ i - POINTING_PAIRS ];
+    if ( i >= POINTING_PAIRS && !worthTrying( technique ) )
+      continue;
+    int placements = 0;
+    probe.begin();
+    uint64_t start = readCycles();
+    bool changed = strategies<N>.apply[ technique ]( board, placements );
+    learned[ technique ].cycles += readCycles() - start;
+    learned[ technique ].calls++;
+    probe.end( static_cast<Technique>( technique ), changed, placements );
+    if ( changed ) {
+      hitsThisPuzzle[ technique ]++;
+      return static_cast<Technique>( technique );
+    }
+  }
+  return NO_TECHNIQUE;
+}
+
+// the hits of a puzzle that finished without search are the useful ones
+template <int N> void AdaptiveScheduler<N>::finishPuzzle( bool logical ) {
+  for ( int technique = 0; technique < TECHNIQUE_COUNT; technique++ ) {
+    if ( logical )
+      learned[ technique ].useful += hitsThisPuzzle[ technique ];
+    hitsThisPuzzle[ technique ] = 0;
+  }
+  if ( ++puzzles % SCHEDULER_HALF_LIFE == 0 ) {
+    for ( Learned &counters : learned ) {
+      counters.calls /= 2;
+      counters.useful /= 2;
+      counters.cycles /= 2;
+    }
+    searches /= 2;
+    searchCycles /= 2;
+  }
+  reorder();
+}
+
+template <int N>
+bool AdaptiveScheduler<N>::solveLogically( BasicBoard<N> &board, SolveStats *stats, SolveTrace *trace,
+                                           SolveBudget *budget ) {
+  bool logical = true;
+  while ( !isSolved( board ) ) {
+    if ( budget && !budget->spend( true ) ) {
+      logical = false;
+      break;
+    }
+    BasicBoard<N> before = board;
+    Technique technique = step( board, stats );
+    if ( sameState( before, board ) ) {
+      logical = false;
+      break;
+    }
+    if ( trace )
+      trace->push_back( technique );
+  }
+  finishPuzzle( logical );
+  return logical;
+}
+
+template <int N>
+bool AdaptiveScheduler<N>::searchFallback( BasicBoard<N> &board, SolveStats *stats, SolveTrace *trace,
+                                           SolveBudget *budget, ThreadPool *pool ) {
+  uint64_t start = readCycles();
+  bool solved = ::searchFallback( board, stats, trace, budget, pool );
+  searchCycles += readCycles() - start;
+  searches++;
+  return solved;
+}
+
+template class AdaptiveScheduler<3>;
+template class AdaptiveScheduler<4>;
+template class AdaptiveScheduler<5>;
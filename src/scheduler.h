@@ -0,0 +1,57 @@
+#pragma once
+
+#include "board.h"
+#include "budget.h"
+#include "stats.h"
+#include "technique.h"
+
+class ThreadPool;
+
+// calls before a technique's numbers are trusted enough to reorder or skip it
+#define SCHEDULER_WARMUP 32
+// a technique that is being skipped is still tried every this many times, in case the puzzles changed
+#define SCHEDULER_EXPLORE 64
+// puzzles after which everything learned so far counts half
+#define SCHEDULER_HALF_LIFE 4096
+
+// The step cascade with its order learned at runtime instead of fixed. For every technique
+// it keeps the cycles a call costs and how often a call leads somewhere: a hit on a puzzle
+// that then finished without search. Singles always go first; after them the techniques
+// are tried best value (useful hits per cycle) first, and one whose expected saving, its
+// useful rate times what a search costs, is less than its own cost is skipped so the board
+// goes to search sooner. Skipping only ever hands more to search, so solutions stay exact.
+//
+// Meant to live as long as a worker and see all its puzzles, one thread only. Traces show
+// whatever order it picked, so grades from it aren't comparable with the fixed ladder's.
+template <int N> class AdaptiveScheduler {
+public:
+  AdaptiveScheduler();
+
+  // solveLogically, stepping in the learned order
+  bool solveLogically( BasicBoard<N> &board, SolveStats *stats = nullptr, SolveTrace *trace = nullptr,
+                       SolveBudget *budget = nullptr );
+  // searchFallback, timed to learn what going to search costs
+  bool searchFallback( BasicBoard<N> &board, SolveStats *stats = nullptr, SolveTrace *trace = nullptr,
+                       SolveBudget *budget = nullptr, ThreadPool *pool = nullptr );
+
+private:
+  struct Learned {
+    double calls = 0;
+    double useful = 0;
+    double cycles = 0;
+    uint32_t skipped = 0;
+  };
+
+  Technique step( BasicBoard<N> &board, SolveStats *stats );
+  bool worthTrying( int technique );
+  void reorder();
+  void finishPuzzle( bool logical );
+
+  Learned learned[ TECHNIQUE_COUNT ];
+  double searches = 0;
+  double searchCycles = 0;
+  uint32_t hitsThisPuzzle[ TECHNIQUE_COUNT ] = {};
+  uint64_t puzzles = 0;
+  // the eliminating techniques, POINTING_PAIRS onwards, in the order they're tried
+  uint8_t order[ SEARCH - POINTING_PAIRS ];
+};
@@ -0,0 +1,281 @@
+#include "search.h"
+#include "kernels.h"
+#include "pool.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// work through the queued cells and units placing singles, false on a contradiction
+template <int N> static bool propagate( BasicBoard<N> &board ) {
+  using B = BasicBoard<N>;
+  while ( 1 ) {
+    int cell;
+    while ( ( cell = popDirtyCell( board ) ) >= 0 ) {
+      typename B::Mask candidates = board.candidates[ cell ];
+      if ( board.values[ cell ] != 0 )
+        continue;
+      if ( candidates == 0 )
+        return false;
+      if ( !( candidates & ( candidates - 1 ) ) )
+        placeValue( board, __builtin_ctz( candidates ) + 1, cell );
+    }
+    if ( !board.dirtyUnits )
+      return true;
+
+    typename B::Mask once[ B::UNIT_COUNT ], twice[ B::UNIT_COUNT ];
+    typename B::UnitMask units = board.dirtyUnits;
+    board.dirtyUnits = 0;
+    countQueuedUnitCandidates( board, units, once, twice );
+    while ( units ) {
+      int unit = lowestUnit( units );
+      units &= units - 1;
+      if ( ( once[ unit ] | board.unitValues[ unit ] ) != B::ALL_CANDIDATES )
+        return false;
+
+      // the counts were taken before this pass placed anything, so recheck each single
+      const auto *cells = boardTables<N>.unitCells[ unit ];
+      uint32_t singles = once[ unit ] & ~twice[ unit ] & ~board.unitValues[ unit ];
+      while ( singles ) {
+        uint32_t bit = singles & -singles;
+        singles &= singles - 1;
+        int i = 0;
+        while ( i < B::GRID_SIZE && !( board.candidates[ cells[ i ] ] & bit ) )
+          i++;
+        // earlier placements took the only cell left for this digit
+        if ( i == B::GRID_SIZE )
+          return false;
+        placeValue( board, __builtin_ctz( bit ) + 1, cells[ i ] );
+      }
+    }
+  }
+}
+
+// the empty cell with the fewest candidates, -1 once every cell is filled
+template <int N> static int branchCell( const BasicBoard<N> &board ) {
+  using B = BasicBoard<N>;
+  int best = -1;
+  int bestCount = B::GRID_SIZE + 1;
+  for ( int cell = 0; cell < B::CELL_COUNT && bestCount > 2; cell++ ) {
+    if ( board.values[ cell ] == 0 ) {
+      int count = __builtin_popcount( board.candidates[ cell ] );
+      if ( count < bestCount ) {
+        best = cell;
+        bestCount = count;
+      }
+    }
+  }
+  return best;
+}
+
+// every node is charged to the budget, which cuts the whole search short once it runs out
+template <int N> static bool search( BasicBoard<N> &board, SolveBudget *budget ) {
+  using B = BasicBoard<N>;
+  if ( budget && !budget->spend() )
+    return false;
+  if ( !propagate( board ) )
+    return false;
+
+  int best = branchCell( board );
+  if ( best < 0 )
+    return true;
+
+  uint32_t candidates = board.candidates[ best ];
+  while ( candidates ) {
+    int num = __builtin_ctz( candidates ) + 1;
+    candidates &= candidates - 1;
+
+    B next = board;
+    placeValue( next, num, best );
+    if ( search( next, budget ) ) {
+      board = next;
+      return true;
+    }
+  }
+  return false;
+}
+
+template <int N> bool searchSolve( BasicBoard<N> &board, SolveBudget *budget ) {
+  BasicBoard<N> next = board;
+  if ( !search( next, budget ) )
+    return false;
+  board = next;
+  return true;
+}
+
+// What the branches of one parallel search share. It lives on the caller's stack, which
+// waits for every branch task to finish, started or not, before returning.
+template <int N> struct Speculation {
+  CancelToken cancel;  // set once a branch has the answer, or the budget has run out
+  std::mutex mutex;
+  std::condition_variable finished;
+  size_t running;
+  bool found = false;
+  BasicBoard<N> solution;
+  std::atomic<uint64_t> steps { 0 };  // the caller's steps so far plus every branch's, against one limit
+  StopReason stopped = STOP_SOLVED;  // a branch that ran out of budget, and why
+};
+
+template <int N>
+static void searchBranch( Speculation<N> &speculation, BasicBoard<N> &board, const SolveBudget *budget ) {
+  // a copy of the caller's limits, watching the shared token instead. Only a step limit
+  // needs the steps counted in the shared total as they're spent; without one every node
+  // would contend for it, so the branch adds its own count once at the end.
+  SolveBudget branch;
+  if ( budget )
+    branch = *budget;
+  branch.watch( &speculation.cancel );
+  bool shared = budget && budget->hasStepLimit();
+  if ( shared )
+    branch.share( &speculation.steps );
+  uint64_t start = branch.steps();
+  bool solved = !speculation.cancel.isCancelled() && search( board, &branch );
+  if ( !shared )
+    speculation.steps += branch.steps() - start;
+
+  std::lock_guard<std::mutex> lock( speculation.mutex );
+  if ( solved && !speculation.found ) {
+    speculation.found = true;
+    speculation.solution = board;
+    speculation.cancel.cancel();
+  } else if ( branch.isExhausted() && branch.reason() != STOP_CANCELLED ) {
+    // out of time or steps in one branch is out of time or steps in all of them
+    speculation.stopped = branch.reason();
+    speculation.cancel.cancel();
+  }
+  if ( --speculation.running == 0 )
+    speculation.finished.notify_all();
+}
+
+template <int N> bool parallelSearchSolve( BasicBoard<N> &board, ThreadPool &pool, SolveBudget *budget ) {
+  using B = BasicBoard<N>;
+  if ( pool.size() < 2 )
+    return searchSolve( board, budget );
+  if ( budget && !budget->spend() )
+    return false;
+  B root = board;
+  if ( !propagate( root ) )
+    return false;
+
+  // Breadth first until there are branches enough to go round. A branch that propagates
+  // into a contradiction is dropped here, so a bivalue cell with one dead side just
+  // carries on down the other.
+  std::deque<B> frontier { root };
+  size_t target = pool.size() * SEARCH_BRANCHES_PER_WORKER;
+  while ( !frontier.empty() && frontier.size() < target ) {
+    if ( budget && !budget->spend() )
+      return false;
+    B node = frontier.front();
+    frontier.pop_front();
+    int best = branchCell( node );
+    if ( best < 0 ) {
+      board = node;
+      return true;
+    }
+    for ( uint32_t candidates = node.candidates[ best ]; candidates; candidates &= candidates - 1 ) {
+      B next = node;
+      placeValue( next, __builtin_ctz( candidates ) + 1, best );
+      if ( propagate( next ) )
+        frontier.push_back( next );
+    }
+  }
+  if ( frontier.empty() )
+    return false;
+
+  std::vector<B> branches( frontier.begin(), frontier.end() );
+  Speculation<N> speculation;
+  speculation.running = branches.size();
+  if ( budget )
+    speculation.steps = budget->steps();
+  for ( B &branch : branches ) {
+    pool.submit( [ &speculation, &branch, budget ] { searchBranch( speculation, branch, budget ); } );
+  }
+  {
+    // the branches only watch the shared token, so the caller's own is passed on from here
+    std::unique_lock<std::mutex> lock( speculation.mutex );
+    while ( !speculation.finished.wait_for( lock, std::chrono::milliseconds( SEARCH_POLL_MS ),
+                                            [ & ] { return speculation.running == 0; } ) ) {
+      if ( budget && !speculation.cancel.isCancelled() && !budget->check() )
+        speculation.cancel.cancel();
+    }
+  }
+
+  if ( budget )
+    budget->charge( speculation.steps - budget->steps(), speculation.stopped );
+  if ( !speculation.found )
+    return false;
+  board = speculation.solution;
+  return true;
+}
+
+// the same search, trying the candidates of each branch cell in random order
+template <int N> static bool searchRandom( BasicBoard<N> &board, std::mt19937_64 &random ) {
+  using B = BasicBoard<N>;
+  if ( !propagate( board ) )
+    return false;
+
+  int best = branchCell( board );
+  if ( best < 0 )
+    return true;
+
+  uint8_t nums[ B::GRID_SIZE ];
+  int count = 0;
+  for ( uint32_t candidates = board.candidates[ best ]; candidates; candidates &= candidates - 1 ) {
+    nums[ count++ ] = __builtin_ctz( candidates ) + 1;
+  }
+  std::shuffle( nums, nums + count, random );
+  for ( int i = 0; i < count; i++ ) {
+    B next = board;
+    placeValue( next, nums[ i ], best );
+    if ( searchRandom( next, random ) ) {
+      board = next;
+      return true;
+    }
+  }
+  return false;
+}
+
+template <int N> static int countFrom( BasicBoard<N> &board, int limit ) {
+  if ( !propagate( board ) )
+    return 0;
+
+  int best = branchCell( board );
+  if ( best < 0 )
+    return 1;
+
+  int found = 0;
+  uint32_t candidates = board.candidates[ best ];
+  while ( candidates && found < limit ) {
+    int num = __builtin_ctz( candidates ) + 1;
+    candidates &= candidates - 1;
+
+    BasicBoard<N> next = board;
+    placeValue( next, num, best );
+    found += countFrom( next, limit - found );
+  }
+  return found;
+}
+
+template <int N> bool searchRandomSolution( BasicBoard<N> &board, std::mt19937_64 &random ) {
+  BasicBoard<N> next = board;
+  if ( !searchRandom( next, random ) )
+    return false;
+  board = next;
+  return true;
+}
+
+template <int N> int countSolutions( const BasicBoard<N> &board, int limit ) {
+  BasicBoard<N> next = board;
+  return countFrom( next, limit );
+}
+
+#define INSTANTIATE_SEARCH( N )                                                                                        \
+  template bool searchSolve( BasicBoard<N> &, SolveBudget * );                                                         \
+  template bool parallelSearchSolve( BasicBoard<N> &, ThreadPool &, SolveBudget * );                                   \
+  template bool searchRandomSolution( BasicBoard<N> &, std::mt19937_64 & );                                            \
+  template int countSolutions( const BasicBoard<N> &, int );
+
+INSTANTIATE_SEARCH( 3 )
+INSTANTIATE_SEARCH( 4 )
+INSTANTIATE_SEARCH( 5 )
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "board.h"
+#include "budget.h"
+#include <random>
+
+class ThreadPool;
+
+// branches handed out per pool worker by parallelSearchSolve, so stealing can even out
+// subtrees of very different sizes
+#define SEARCH_BRANCHES_PER_WORKER 8
+// how often a parallel search's caller looks at its budget while it waits, in ms
+#define SEARCH_POLL_MS 1
+
+// Depth-first search over the candidate masks already narrowed down by the logical
+// techniques, branching on the cell with the fewest candidates. Fills board and returns
+// true when a solution exists, leaves it untouched otherwise. With a budget every node is
+// a step, and false may also mean it ran out: check budget->isExhausted().
+template <int N> bool searchSolve( BasicBoard<N> &board, SolveBudget *budget = nullptr );
+// The same search with the top of the tree split over pool: the branches of the first few
+// branch cells are expanded breadth first, dead ones dropped, and the rest searched as
+// separate tasks, each on its own copy of the board. The first to find a solution cancels
+// the others. Meant for one hard 16x16 or 25x25 board at a time; a 9x9 search is over
+// before the branches would be handed out. Not to be called from one of pool's workers.
+// With several solutions it may not find the one searchSolve would. A step limit holds for
+// all the branches together: the first to cross it cancels the others.
+template <int N> bool parallelSearchSolve( BasicBoard<N> &board, ThreadPool &pool, SolveBudget *budget = nullptr );
+// a random solution, e.g. a fresh full grid when started from an empty board; false if there is none
+template <int N> bool searchRandomSolution( BasicBoard<N> &board, std::mt19937_64 &random );
+// number of solutions, counting stops once limit are found
+template <int N> int countSolutions( const BasicBoard<N> &board, int limit );
@@ -0,0 +1,662 @@
+#include "server.h"
+#include "board.h"
+#include "cache.h"
+#include "histogram.h"
+#include "lineio.h"
+#include "pool.h"
+#include "scheduler.h"
+#include "solver.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+// bytes taken from a socket per readable event, so one busy client can't starve the rest
+#define SERVER_READ_SIZE ( 1 << 16 )
+// a request that long without a newline closes the connection
+#define SERVER_MAX_LINE ( 1 << 16 )
+// requests stop being answered while this much of a connection's output is still unsent
+#define SERVER_MAX_OUTPUT ( 1 << 20 )
+#define SERVER_EVENTS 64
+// solutions kept for repeated puzzles unless --cache says otherwise
+#define SERVER_CACHE_ENTRIES ( 1 << 16 )
+
+using ordered_json = nlohmann::ordered_json;
+using Clock = std::chrono::steady_clock;
+
+// A connection belongs to one worker for its whole life. Requests are answered in the
+// order they arrive, so a client can pipeline as many as it likes and match the replies
+// up by position. Both buffers keep their capacity, so a steady connection stops
+// allocating after its first few requests.
+struct Connection {
+  int fd;
+  std::string input;   // received, from the first request not yet answered
+  std::string output;  // replies from outputSent on are still to be sent
+  size_t outputSent = 0;
+  size_t queued = 0;   // complete requests in input
+  uint32_t events = 0; // what epoll is currently asked to report
+  bool closing = false;
+};
+
+struct alignas( 64 ) ServerWorker {
+  int epollFd = -1;
+  int wakeFd = -1;
+  std::thread thread;
+
+  // accepted sockets waiting to be picked up by the worker
+  std::mutex incomingMutex;
+  std::vector<int> incoming;
+
+  std::unordered_map<int, std::unique_ptr<Connection>> connections;
+
+  // read by the stats request from any worker, so recorded under the lock
+  std::mutex statsMutex;
+  LatencyHistogram solveLatencies;    // parse, solve and format
+  LatencyHistogram requestLatencies;  // the same plus the wait behind requests pipelined ahead of it
+  uint64_t requests = 0;
+  uint64_t errors = 0;
+};
+
+struct Server {
+  std::vector<std::unique_ptr<ServerWorker>> workers;
+  std::atomic<size_t> connections { 0 };
+  std::atomic<size_t> queued { 0 };
+  std::atomic<bool> stopping { false };
+  Clock::time_point started = Clock::now();
+  std::unique_ptr<SolutionCache> cache;  // 9x9 only, null with --cache 0
+  // per-request limits, none when 0
+  std::chrono::microseconds timeLimit { 0 };
+  uint64_t stepLimit = 0;
+  CancelToken shutdown;  // cuts solves still running on the way down short
+  std::unique_ptr<ThreadPool> speculation;  // splits 16x16 and 25x25 searches, null without --speculate
+  int pipeline = HUMAN_PIPELINE;
+};
+
+static ordered_json latencyJson( const LatencyHistogram &histogram ) {
+  return { { "p50", histogram.percentile( 0.50 ) / 1000.0 },
+           { "p90", histogram.percentile( 0.90 ) / 1000.0 },
+           { "p99", histogram.percentile( 0.99 ) / 1000.0 },
+           { "p999", histogram.percentile( 0.999 ) / 1000.0 },
+           { "max", histogram.max() / 1000.0 } };
+}
+
+// [ bucket lower bound in ns, count ] for every non-empty bucket
+static ordered_json bucketsJson( const LatencyHistogram &histogram ) {
+  ordered_json buckets = ordered_json::array();
+  for ( int i = 0; i < HISTOGRAM_BUCKETS; i++ ) {
+    if ( histogram.bucketCount( i ) )
+      buckets.push_back( { LatencyHistogram::lowerBound( i ), histogram.bucketCount( i ) } );
+  }
+  return buckets;
+}
+
+static std::string statsReply( Server &server ) {
+  LatencyHistogram solve, request;
+  uint64_t requests = 0, errors = 0;
+  for ( const auto &worker : server.workers ) {
+    std::lock_guard<std::mutex> lock( worker->statsMutex );
+    solve.merge( worker->solveLatencies );
+    request.merge( worker->requestLatencies );
+    requests += worker->requests;
+    errors += worker->errors;
+  }
+  double uptime = std::chrono::duration<double>( Clock::now() - server.started ).count();
+  ordered_json stats = { { "uptime_s", uptime },
+                         { "threads", server.workers.size() },
+                         { "connections", server.connections.load() },
+                         { "queue_depth", server.queued.load() },
+                         { "requests", requests },
+                         { "errors", errors },
+                         { "solve_us", latencyJson( solve ) },
+                         { "request_us", latencyJson( request ) },
+                         { "cache", { { "entries", server.cache ? server.cache->size() : 0 },
+                                      { "hits", server.cache ? server.cache->hits() : 0 },
+                                      { "misses", server.cache ? server.cache->misses() : 0 } } },
+                         { "histograms", { { "solve", bucketsJson( solve ) }, { "request", bucketsJson( request ) } } } };
+  return stats.dump();
+}
+
+// a filled grid is only right if every unit ended up holding every digit
+template <int N> static bool solvedCorrectly( const BasicBoard<N> &board ) {
+  if ( !isSolved( board ) )
+    return false;
+  for ( auto values : board.unitValues ) {
+    if ( values != BasicBoard<N>::ALL_CANDIDATES )
+      return false;
+  }
+  return true;
+}
+
+template <int N>
+static StopReason solveUncached( Server &server, BasicBoard<N> &board, SolveBudget &budget, SolveTrace &trace ) {
+  StopReason reason;
+  if ( server.pipeline == ADAPTIVE_PIPELINE ) {
+    // one per worker thread and board size, learning from every request it answers
+    thread_local AdaptiveScheduler<N> scheduler;
+    bool solved = scheduler.solveLogically( board, nullptr, &trace, &budget ) ||
+                  ( !budget.isExhausted() &&
+                    scheduler.searchFallback( board, nullptr, &trace, &budget, server.speculation.get() ) );
+    reason = solved ? STOP_SOLVED : budget.isExhausted() ? budget.reason() : STOP_NO_SOLUTION;
+  } else {
+    reason = solveWithBudget( board, budget, nullptr, &trace, server.speculation.get(), server.pipeline );
+  }
+  return reason == STOP_SOLVED && !solvedCorrectly( board ) ? STOP_NO_SOLUTION : reason;
+}
+
+// canonicalize indexes its digit labels by the cell values, so nothing outside 0..9 may
+// reach the cache; the parsers already turn such boards down, this keeps it that way
+static bool cacheableDigits( const uint8_t values[ Board::CELL_COUNT ] ) {
+  for ( int cell = 0; cell < Board::CELL_COUNT; cell++ ) {
+    if ( values[ cell ] > Board::GRID_SIZE )
+      return false;
+  }
+  return true;
+}
+
+// A cache hit only fills in the values, which is all the replies are formatted from.
+// Partial results aren't cached: with more time the same puzzle may well be solved.
+template <int N>
+static StopReason solveBoard( Server &server, BasicBoard<N> &board, SolveBudget &budget, SolveTrace &trace ) {
+  SolutionCache *cache = server.cache.get();
+  if constexpr ( N == 3 ) {
+    if ( cache && cacheableDigits( board.values ) ) {
+      CacheKey key;
+      uint8_t solution[ Board::CELL_COUNT ];
+      if ( cache->lookup( board.values, key, solution ) ) {
+        std::memcpy( board.values, solution, sizeof( solution ) );
+        return STOP_SOLVED;
+      }
+      StopReason reason = solveUncached( server, board, budget, trace );
+      if ( reason == STOP_SOLVED )
+        cache->insert( key, board.values );
+      return reason;
+    }
+  }
+  return solveUncached( server, board, budget, trace );
+}
+
+static SolveBudget requestBudget( Server &server ) {
+  SolveBudget budget;
+  if ( server.timeLimit.count() > 0 )
+    budget.setTimeLimit( server.timeLimit );
+  if ( server.stepLimit > 0 )
+    budget.setStepLimit( server.stepLimit );
+  budget.watch( &server.shutdown );
+  return budget;
+}
+
+// "no solution", "time limit"...
+static std::string reasonText( StopReason reason ) {
+  std::string text = stopReasonName( reason );
+  std::replace( text.begin(), text.end(), '_', ' ' );
+  return text;
+}
+
+// the solved line, or an error line; one that ran out of budget carries the grid as far
+// as it got, in the same line format
+static bool solveLineRequest( Server &server, const char *line, size_t length, std::string &out ) {
+  return withBoxSize( lineBoxSize( line, length ), [ & ]( auto size ) {
+    constexpr int N = decltype( size )::value;
+    constexpr size_t cells = BasicBoard<N>::CELL_COUNT;
+    BasicBoard<N> board;
+    if ( !parseLineBoard( line, length, board ) ) {
+      out += "error malformed board\n";
+      return false;
+    }
+    SolveBudget budget = requestBudget( server );
+    thread_local SolveTrace trace;
+    trace.clear();
+    StopReason reason = solveBoard( server, board, budget, trace );
+    if ( reason == STOP_NO_SOLUTION ) {
+      out += "error no solution\n";
+      return false;
+    }
+    if ( reason != STOP_SOLVED )
+      out += "error " + reasonText( reason ) + ' ';
+    size_t used = out.size();
+    out.resize( used + cells + 1 );
+    formatLineBoard( board, &out[ used ] );
+    out[ used + cells ] = '\n';
+    return reason == STOP_SOLVED;
+  } );
+}
+
+// {"value": grid} in the boards.json schema gets {"solution": grid} or {"error": "..."},
+// with the request's "id" copied over when it has one. A solve that ran out of budget also
+// gets the partial result: "partial" the grid so far, "candidates" the digit mask left in
+// each cell (bit d - 1 for digit d, 0 where a digit is placed), "techniques" one code per
+// step applied and "steps" what the budget was charged.
+static bool solveJsonRequest( Server &server, const char *line, size_t length, std::string &out ) {
+  json reply = json::object();
+  bool solved = false;
+  try {
+    const json request = json::parse( line, line + length );
+    if ( request.contains( "id" ) )
+      reply[ "id" ] = request.at( "id" );
+    const json &grid = request.at( "value" );
+    int boxSize = jsonBoxSize( grid );
+    if ( boxSize == 0 ) {
+      reply[ "error" ] = "malformed board";
+    } else {
+      withBoxSize( boxSize, [ & ]( auto size ) {
+        BasicBoard<decltype( size )::value> board = boardFromJson<decltype( size )::value>( grid );
+        SolveBudget budget = requestBudget( server );
+        thread_local SolveTrace trace;
+        trace.clear();
+        StopReason reason = solveBoard( server, board, budget, trace );
+        solved = reason == STOP_SOLVED;
+        if ( solved ) {
+          reply[ "solution" ] = boardToJson( board );
+          return;
+        }
+        reply[ "error" ] = reasonText( reason );
+        if ( reason == STOP_NO_SOLUTION )
+          return;
+        std::string techniques;
+        for ( uint8_t technique : trace ) {
+          techniques += techniqueCode( technique );
+        }
+        reply[ "reason" ] = stopReasonName( reason );
+        reply[ "partial" ] = boardToJson( board );
+        reply[ "candidates" ] = board.candidates;
+        reply[ "techniques" ] = techniques;
+        reply[ "steps" ] = budget.steps();
+      } );
+    }
+  } catch ( const std::exception &e ) {
+    reply[ "error" ] = e.what();
+  }
+  out += reply.dump();
+  out += '\n';
+  return solved;
+}
+
+static void handleRequest( Server &server, ServerWorker &worker, const char *line, size_t length,
+                           Clock::time_point received, std::string &out ) {
+  if ( length == 5 && std::memcmp( line, "stats", 5 ) == 0 ) {
+    out += statsReply( server );
+    out += '\n';
+    return;
+  }
+
+  auto start = Clock::now();
+  bool ok = line[ 0 ] == '{' ? solveJsonRequest( server, line, length, out ) : solveLineRequest( server, line, length, out );
+  auto stop = Clock::now();
+
+  std::lock_guard<std::mutex> lock( worker.statsMutex );
+  worker.solveLatencies.record( std::chrono::duration_cast<std::chrono::nanoseconds>( stop - start ).count() );
+  worker.requestLatencies.record( std::chrono::duration_cast<std::chrono::nanoseconds>( stop - received ).count() );
+  worker.requests++;
+  worker.errors += !ok;
+}
+
+// answers complete requests until the input runs out or the output backs up
+static void answerRequests( Server &server, ServerWorker &worker, Connection &connection,
+                            Clock::time_point received ) {
+  size_t begin = 0;
+  while ( connection.queued > 0 && connection.output.size() - connection.outputSent < SERVER_MAX_OUTPUT ) {
+    size_t offset = begin;
+    size_t length = nextLine( connection.input.data(), connection.input.size(), offset );
+    if ( length > 0 )
+      handleRequest( server, worker, connection.input.data() + begin, length, received, connection.output );
+    begin = offset;
+    connection.queued--;
+    server.queued--;
+  }
+  connection.input.erase( 0, begin );
+}
+
+// false once the peer is gone
+static bool sendOutput( Connection &connection ) {
+  while ( connection.outputSent < connection.output.size() ) {
+    ssize_t sent = send( connection.fd, connection.output.data() + connection.outputSent,
+                         connection.output.size() - connection.outputSent, MSG_NOSIGNAL );
+    if ( sent < 0 )
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    connection.outputSent += sent;
+  }
+  connection.output.clear();
+  connection.outputSent = 0;
+  return true;
+}
+
+// false once the peer has closed its end or the connection broke
+static bool readInput( Server &server, Connection &connection, char *buffer ) {
+  ssize_t received = recv( connection.fd, buffer, SERVER_READ_SIZE, 0 );
+  if ( received < 0 )
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+  if ( received == 0 )
+    return false;
+  size_t lines = std::count( buffer, buffer + received, '\n' );
+  connection.input.append( buffer, received );
+  connection.queued += lines;
+  server.queued += lines;
+  return true;
+}
+
+static void closeConnection( Server &server, ServerWorker &worker, int fd ) {
+  auto found = worker.connections.find( fd );
+  server.queued -= found->second->queued;
+  server.connections--;
+  close( fd );
+  worker.connections.erase( found );
+}
+
+// reads, answers and writes whatever the socket is ready for, then asks epoll for what's
+// needed next: input while there's room for more replies, output while replies are pending
+static void serviceConnection( Server &server, ServerWorker &worker, Connection &connection, uint32_t events,
+                               char *buffer ) {
+  Clock::time_point received = Clock::now();
+  bool alive = true;
+  if ( events & ( EPOLLIN | EPOLLHUP | EPOLLERR ) ) {
+    if ( !readInput( server, connection, buffer ) )
+      connection.closing = true;
+  }
+  answerRequests( server, worker, connection, received );
+  if ( connection.queued == 0 && connection.input.size() > SERVER_MAX_LINE )
+    alive = false;
+  if ( alive )
+    alive = sendOutput( connection );
+
+  bool pending = connection.outputSent < connection.output.size();
+  // a closed peer still gets the replies to everything it sent before closing
+  if ( !alive || ( connection.closing && !pending && connection.queued == 0 ) ) {
+    closeConnection( server, worker, connection.fd );
+    return;
+  }
+
+  uint32_t wanted = 0;
+  if ( !connection.closing && connection.output.size() - connection.outputSent < SERVER_MAX_OUTPUT )
+    wanted |= EPOLLIN;
+  if ( pending || connection.queued > 0 )
+    wanted |= EPOLLOUT;
+  if ( wanted != connection.events ) {
+    epoll_event event = {};
+    event.events = wanted;
+    event.data.fd = connection.fd;
+    epoll_ctl( worker.epollFd, EPOLL_CTL_MOD, connection.fd, &event );
+    connection.events = wanted;
+  }
+}
+
+static void adoptConnections( Server &server, ServerWorker &worker ) {
+  std::vector<int> incoming;
+  {
+    std::lock_guard<std::mutex> lock( worker.incomingMutex );
+    incoming.swap( worker.incoming );
+  }
+  for ( int fd : incoming ) {
+    auto connection = std::make_unique<Connection>();
+    connection->fd = fd;
+    connection->events = EPOLLIN;
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if ( epoll_ctl( worker.epollFd, EPOLL_CTL_ADD, fd, &event ) != 0 ) {
+      close( fd );
+      server.connections--;
+      continue;
+    }
+    worker.connections.emplace( fd, std::move( connection ) );
+  }
+}
+
+static void runWorker( Server &server, ServerWorker &worker ) {
+  std::vector<char> buffer( SERVER_READ_SIZE );
+  epoll_event events[ SERVER_EVENTS ];
+  while ( !server.stopping ) {
+    int count = epoll_wait( worker.epollFd, events, SERVER_EVENTS, -1 );
+    for ( int i = 0; i < count; i++ ) {
+      int fd = events[ i ].data.fd;
+      if ( fd == worker.wakeFd ) {
+        uint64_t value;
+        while ( read( worker.wakeFd, &value, sizeof( value ) ) > 0 ) {
+        }
+        adoptConnections( server, worker );
+        continue;
+      }
+      auto found = worker.connections.find( fd );
+      if ( found != worker.connections.end() )
+        serviceConnection( server, worker, *found->second, events[ i ].events, buffer.data() );
+    }
+  }
+
+  for ( auto &entry : worker.connections ) {
+    close( entry.first );
+  }
+  worker.connections.clear();
+}
+
+// hands the socket to the next worker round-robin
+static void dispatchConnection( Server &server, int fd, size_t &next ) {
+  ServerWorker &worker = *server.workers[ next++ % server.workers.size() ];
+  server.connections++;
+  {
+    std::lock_guard<std::mutex> lock( worker.incomingMutex );
+    worker.incoming.push_back( fd );
+  }
+  uint64_t one = 1;
+  if ( write( worker.wakeFd, &one, sizeof( one ) ) < 0 )
+    std::cerr << "failed to wake a worker" << std::endl;
+}
+
+static int listenUnix( const std::string &path ) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if ( path.size() >= sizeof( address.sun_path ) ) {
+    std::cerr << "socket path too long: " << path << std::endl;
+    return -1;
+  }
+  std::memcpy( address.sun_path, path.c_str(), path.size() + 1 );
+
+  int fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+  if ( fd < 0 )
+    return -1;
+
+  // a socket file left behind by a server that died is replaced, a live one is not
+  struct stat info;
+  if ( stat( path.c_str(), &info ) == 0 && S_ISSOCK( info.st_mode ) ) {
+    int probe = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+    bool live = connect( probe, reinterpret_cast<sockaddr *>( &address ), sizeof( address ) ) == 0;
+    close( probe );
+    if ( live ) {
+      std::cerr << "another server is listening on " << path << std::endl;
+      close( fd );
+      return -1;
+    }
+    unlink( path.c_str() );
+  }
+
+  if ( bind( fd, reinterpret_cast<sockaddr *>( &address ), sizeof( address ) ) != 0 || listen( fd, SOMAXCONN ) != 0 ) {
+    std::cerr << "failed to listen on " << path << ": " << std::strerror( errno ) << std::endl;
+    close( fd );
+    return -1;
+  }
+  return fd;
+}
+
+// localhost only
+static int listenTcp( int port ) {
+  int fd = socket( AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+  if ( fd < 0 )
+    return -1;
+  int one = 1;
+  setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof( one ) );
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons( port );
+  address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+  if ( bind( fd, reinterpret_cast<sockaddr *>( &address ), sizeof( address ) ) != 0 || listen( fd, SOMAXCONN ) != 0 ) {
+    std::cerr << "failed to listen on port " << port << ": " << std::strerror( errno ) << std::endl;
+    close( fd );
+    return -1;
+  }
+  return fd;
+}
+
+static int usage() {
+  std::cerr << "usage: sudoku serve [--socket path] [--port N] [--threads N] [--cache entries] [--cache-file path]"
+               " [--time-limit ms] [--step-limit N] [--speculate N]"
+               " [--pipeline singles|basic|human|adaptive]"
+            << std::endl;
+  return 2;
+}
+
+int runServe( int argc, char **argv ) {
+  std::string socketPath;
+  int port = 0;
+  unsigned threads = std::thread::hardware_concurrency();
+  size_t cacheEntries = SERVER_CACHE_ENTRIES;
+  std::string cachePath;
+  std::chrono::microseconds timeLimit { 0 };
+  uint64_t stepLimit = 0;
+  unsigned speculateThreads = 0;
+  int pipeline = HUMAN_PIPELINE;
+  for ( int i = 0; i < argc; i++ ) {
+    std::string arg = argv[ i ];
+    if ( arg == "--socket" && i + 1 < argc ) {
+      socketPath = argv[ ++i ];
+    } else if ( arg == "--port" && i + 1 < argc ) {
+      port = std::stoi( argv[ ++i ] );
+    } else if ( arg == "--threads" && i + 1 < argc ) {
+      threads = std::stoul( argv[ ++i ] );
+    } else if ( arg == "--cache" && i + 1 < argc ) {
+      cacheEntries = std::stoull( argv[ ++i ] );
+    } else if ( arg == "--cache-file" && i + 1 < argc ) {
+      cachePath = argv[ ++i ];
+    } else if ( arg == "--time-limit" && i + 1 < argc ) {
+      timeLimit = std::chrono::microseconds( static_cast<int64_t>( std::stod( argv[ ++i ] ) * 1000 ) );
+    } else if ( arg == "--step-limit" && i + 1 < argc ) {
+      stepLimit = std::stoull( argv[ ++i ] );
+    } else if ( arg == "--speculate" && i + 1 < argc ) {
+      speculateThreads = std::stoul( argv[ ++i ] );
+    } else if ( arg == "--pipeline" && i + 1 < argc ) {
+      pipeline = parsePipeline( argv[ ++i ] );
+      if ( pipeline == PIPELINE_COUNT )
+        return usage();
+    } else {
+      return usage();
+    }
+  }
+  if ( socketPath.empty() && port == 0 )
+    socketPath = "sudoku.sock";
+  threads = std::max( 1u, threads );
+
+  std::vector<pollfd> listeners;
+  int tcpFd = -1;
+  if ( !socketPath.empty() ) {
+    int fd = listenUnix( socketPath );
+    if ( fd < 0 )
+      return 1;
+    listeners.push_back( { fd, POLLIN, 0 } );
+  }
+  if ( port != 0 ) {
+    tcpFd = listenTcp( port );
+    if ( tcpFd < 0 )
+      return 1;
+    listeners.push_back( { tcpFd, POLLIN, 0 } );
+  }
+
+  // blocked before the workers start so they inherit the mask and only the signalfd sees them
+  sigset_t signals;
+  sigemptyset( &signals );
+  sigaddset( &signals, SIGINT );
+  sigaddset( &signals, SIGTERM );
+  pthread_sigmask( SIG_BLOCK, &signals, nullptr );
+  int signalFd = signalfd( -1, &signals, SFD_CLOEXEC );
+
+  Server server;
+  server.timeLimit = timeLimit;
+  server.stepLimit = stepLimit;
+  server.pipeline = pipeline;
+  if ( speculateThreads > 0 )
+    server.speculation = std::make_unique<ThreadPool>( speculateThreads );
+  if ( cacheEntries > 0 ) {
+    server.cache = std::make_unique<SolutionCache>( cacheEntries );
+    // a missing file is just an empty cache, a broken one is worth saying so
+    if ( !cachePath.empty() && access( cachePath.c_str(), F_OK ) == 0 && !server.cache->load( cachePath ) )
+      std::cerr << "ignoring unreadable cache file " << cachePath << std::endl;
+  }
+  for ( unsigned i = 0; i < threads; i++ ) {
+    auto worker = std::make_unique<ServerWorker>();
+    worker->epollFd = epoll_create1( EPOLL_CLOEXEC );
+    worker->wakeFd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = worker->wakeFd;
+    epoll_ctl( worker->epollFd, EPOLL_CTL_ADD, worker->wakeFd, &event );
+    server.workers.push_back( std::move( worker ) );
+  }
+  for ( auto &worker : server.workers ) {
+    worker->thread = std::thread( runWorker, std::ref( server ), std::ref( *worker ) );
+  }
+
+  std::cerr << "listening on" << ( socketPath.empty() ? "" : " " + socketPath )
+            << ( port ? " 127.0.0.1:" + std::to_string( port ) : "" ) << " with " << threads << " workers"
+            << std::endl;
+
+  std::vector<pollfd> polled = listeners;
+  polled.push_back( { signalFd, POLLIN, 0 } );
+  size_t next = 0;
+  while ( !server.stopping ) {
+    if ( poll( polled.data(), polled.size(), -1 ) < 0 )
+      continue;
+    if ( polled.back().revents )
+      server.stopping = true;
+    for ( size_t i = 0; i + 1 < polled.size(); i++ ) {
+      if ( !( polled[ i ].revents & POLLIN ) )
+        continue;
+      int fd = accept4( polled[ i ].fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC );
+      if ( fd < 0 )
+        continue;
+      // replies are small and the client is waiting on them
+      if ( polled[ i ].fd == tcpFd ) {
+        int one = 1;
+        setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof( one ) );
+      }
+      dispatchConnection( server, fd, next );
+    }
+  }
+
+  server.shutdown.cancel();
+  for ( auto &worker : server.workers ) {
+    uint64_t one = 1;
+    if ( write( worker->wakeFd, &one, sizeof( one ) ) < 0 )
+      std::cerr << "failed to wake a worker" << std::endl;
+  }
+  for ( auto &worker : server.workers ) {
+    worker->thread.join();
+    close( worker->epollFd );
+    close( worker->wakeFd );
+  }
+  for ( const pollfd &listener : listeners ) {
+    close( listener.fd );
+  }
+  close( signalFd );
+  if ( !socketPath.empty() )
+    unlink( socketPath.c_str() );
+  if ( server.cache && !cachePath.empty() && !server.cache->save( cachePath ) ) {
+    std::cerr << "failed to write " << cachePath << std::endl;
+    return 1;
+  }
+  return 0;
+}
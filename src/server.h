@@ -0,0 +1,4 @@
+#pragma once
+
+// sudoku serve [--socket path] [--port N] [--threads N]
+int runServe( int argc, char **argv );
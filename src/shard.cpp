@@ -0,0 +1,401 @@
+#include "shard.h"
+#include "batch.h"
+#include "corpus.h"
+#include "lineio.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define SHARD_DEFAULT_COUNT 64
+
+// the report lines summed over every shard's batch report
+static const char *const reportKeys[] = { "puzzles", "skipped", "solved", "searched", "stalled", "incorrect" };
+
+struct ShardJob {
+  std::string dir;
+  size_t shards = SHARD_DEFAULT_COUNT;
+  std::string gradeExtension;          // ".csv" or ".json" when grading, empty otherwise
+  std::vector<std::string> batchArgs;  // handed to every shard's batch as they are
+};
+
+// dir/shard-00042.suffix
+static std::string shardPath( const ShardJob &job, size_t shard, const std::string &suffix ) {
+  char name[ 32 ];
+  std::snprintf( name, sizeof( name ), "/shard-%05zu", shard );
+  return job.dir + name + suffix;
+}
+
+static bool exists( const std::string &path ) { return access( path.c_str(), F_OK ) == 0; }
+
+static bool readFile( const std::string &path, std::string &text ) {
+  std::ifstream in( path, std::ios::binary );
+  if ( !in )
+    return false;
+  std::ostringstream contents;
+  contents << in.rdbuf();
+  text = contents.str();
+  return true;
+}
+
+// written to a temporary name and renamed, so the file is either all there or not at all
+static bool writeFileAtomically( const std::string &path, const std::string &text ) {
+  std::string temporary = path + ".tmp";
+  {
+    std::ofstream out( temporary, std::ios::binary );
+    out << text;
+    if ( !out )
+      return false;
+  }
+  return std::rename( temporary.c_str(), path.c_str() ) == 0;
+}
+
+// Cuts the line file into job.shards files of consecutive boards, as even as they come.
+// Lines without a board are left out, batch would skip them anyway.
+static bool splitLines( const std::string &path, const ShardJob &job ) {
+  MappedFile file;
+  if ( !file.open( path ) ) {
+    std::cerr << "failed to open " << path << std::endl;
+    return false;
+  }
+  size_t boards = 0;
+  for ( size_t offset = 0; offset < file.size(); ) {
+    const char *line = file.data() + offset;
+    boards += lineBoxSize( line, nextLine( file.data(), file.size(), offset ) ) != 0;
+  }
+
+  size_t offset = 0;
+  for ( size_t shard = 0; shard < job.shards; shard++ ) {
+    size_t count = boards / job.shards + ( shard < boards % job.shards );
+    std::string shardInput = shardPath( job, shard, ".txt" );
+    std::unique_ptr<BufferedWriter> out = BufferedWriter::open( shardInput );
+    if ( !out ) {
+      std::cerr << "failed to open " << shardInput << std::endl;
+      return false;
+    }
+    while ( count > 0 && offset < file.size() ) {
+      const char *line = file.data() + offset;
+      size_t length = nextLine( file.data(), file.size(), offset );
+      if ( lineBoxSize( line, length ) == 0 )
+        continue;
+      out->write( line, length );
+      out->put( '\n' );
+      count--;
+    }
+    if ( !out->flush() ) {
+      std::cerr << "failed to write " << shardInput << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Shard inputs are always in the line format: json and corpus input is converted first.
+// The manifest goes last, so a directory with one has every shard input in place.
+static bool prepareShards( const std::string &input, const ShardJob &job, const std::string &manifest ) {
+  std::string lines = input;
+  if ( isJsonPath( input ) || isCorpusPath( input ) ) {
+    lines = job.dir + "/input.txt";
+    std::string in = input;
+    char *convertArgs[] = { in.data(), lines.data() };
+    if ( runConvert( 2, convertArgs ) != 0 )
+      return false;
+  }
+  if ( !splitLines( lines, job ) )
+    return false;
+  if ( lines != input )
+    std::remove( lines.c_str() );
+  if ( !writeFileAtomically( job.dir + "/manifest", manifest ) ) {
+    std::cerr << "failed to write " << job.dir << "/manifest" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// In the forked child: batch over one shard, its report and errors going to the shard's
+// log. Outputs are written under temporary names the parent renames once the batch succeeded.
+[[noreturn]] static void runShardBatch( const ShardJob &job, size_t shard, pid_t parent ) {
+  // a driver that is killed takes its shards with it, so a restart never races an orphan
+  prctl( PR_SET_PDEATHSIG, SIGKILL );
+  if ( getppid() != parent )
+    _exit( 1 );
+  std::string log = shardPath( job, shard, ".log" );
+  int fd = open( log.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+  if ( fd < 0 || dup2( fd, STDOUT_FILENO ) < 0 || dup2( fd, STDERR_FILENO ) < 0 )
+    _exit( 1 );
+
+  std::vector<std::string> args = { shardPath( job, shard, ".txt" ), "--output", shardPath( job, shard, ".out.tmp" ) };
+  if ( !job.gradeExtension.empty() ) {
+    args.push_back( "--grade" );
+    args.push_back( shardPath( job, shard, ".grades.tmp" + job.gradeExtension ) );
+  }
+  args.insert( args.end(), job.batchArgs.begin(), job.batchArgs.end() );
+  std::vector<char *> argv;
+  for ( std::string &arg : args ) {
+    argv.push_back( arg.data() );
+  }
+  int result = runBatch( argv.size(), argv.data() );
+  std::cout.flush();
+  std::cerr.flush();
+  _exit( result );
+}
+
+// the checkpoint: outputs renamed into place, then the .done marker
+static bool finishShard( const ShardJob &job, size_t shard ) {
+  if ( std::rename( shardPath( job, shard, ".out.tmp" ).c_str(), shardPath( job, shard, ".out" ).c_str() ) != 0 )
+    return false;
+  if ( !job.gradeExtension.empty() &&
+       std::rename( shardPath( job, shard, ".grades.tmp" + job.gradeExtension ).c_str(),
+                    shardPath( job, shard, ".grades" + job.gradeExtension ).c_str() ) != 0 )
+    return false;
+  return writeFileAtomically( shardPath( job, shard, ".done" ), "" );
+}
+
+// Runs the shards not done yet, jobs processes at a time. A shard whose process fails or
+// dies is reported and left for the next run; the others carry on.
+static size_t runShards( const ShardJob &job, unsigned jobs ) {
+  std::vector<size_t> pending;
+  for ( size_t shard = 0; shard < job.shards; shard++ ) {
+    if ( !exists( shardPath( job, shard, ".done" ) ) )
+      pending.push_back( shard );
+  }
+  std::cerr << job.shards - pending.size() << " of " << job.shards << " shards already done" << std::endl;
+
+  pid_t self = getpid();
+  std::map<pid_t, size_t> running;
+  size_t next = 0, failed = 0;
+  while ( next < pending.size() || !running.empty() ) {
+    while ( next < pending.size() && running.size() < jobs ) {
+      size_t shard = pending[ next++ ];
+      // nothing buffered may be written twice, once by each process
+      std::cout.flush();
+      std::cerr.flush();
+      pid_t pid = fork();
+      if ( pid == 0 )
+        runShardBatch( job, shard, self );
+      if ( pid < 0 ) {
+        std::cerr << "failed to start shard " << shard << ": " << std::strerror( errno ) << std::endl;
+        failed++;
+        continue;
+      }
+      running[ pid ] = shard;
+    }
+
+    int status;
+    pid_t pid = waitpid( -1, &status, 0 );
+    if ( pid < 0 ) {
+      if ( errno == EINTR )
+        continue;
+      break;
+    }
+    auto found = running.find( pid );
+    if ( found == running.end() )
+      continue;
+    size_t shard = found->second;
+    running.erase( found );
+    if ( WIFEXITED( status ) && WEXITSTATUS( status ) == 0 && finishShard( job, shard ) ) {
+      std::cerr << "shard " << shard << " done" << std::endl;
+      continue;
+    }
+    failed++;
+    std::cerr << "shard " << shard << " failed";
+    if ( WIFSIGNALED( status ) )
+      std::cerr << " with signal " << WTERMSIG( status );
+    else if ( WIFEXITED( status ) )
+      std::cerr << " with exit code " << WEXITSTATUS( status );
+    std::cerr << ", see " << shardPath( job, shard, ".log" ) << std::endl;
+  }
+  return failed;
+}
+
+// the per-shard files one after the other, in shard order and so in input order
+static bool mergeOutputs( const ShardJob &job, const std::string &outputPath ) {
+  std::unique_ptr<BufferedWriter> out = BufferedWriter::open( outputPath );
+  if ( !out ) {
+    std::cerr << "failed to open " << outputPath << std::endl;
+    return false;
+  }
+  for ( size_t shard = 0; shard < job.shards; shard++ ) {
+    std::string text;
+    if ( !readFile( shardPath( job, shard, ".out" ), text ) ) {
+      std::cerr << "failed to read " << shardPath( job, shard, ".out" ) << std::endl;
+      return false;
+    }
+    out->write( text.data(), text.size() );
+  }
+  if ( !out->flush() ) {
+    std::cerr << "failed to write " << outputPath << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// csv keeps the first shard's header only; json arrays are joined into one
+static bool mergeGrades( const ShardJob &job, const std::string &gradePath ) {
+  bool asJson = job.gradeExtension == ".json";
+  std::string merged = asJson ? "[" : "";
+  bool first = true;
+  for ( size_t shard = 0; shard < job.shards; shard++ ) {
+    std::string path = shardPath( job, shard, ".grades" + job.gradeExtension );
+    std::string text;
+    if ( !readFile( path, text ) ) {
+      std::cerr << "failed to read " << path << std::endl;
+      return false;
+    }
+    if ( asJson ) {
+      // "[\n  {...},\n  {...}\n]\n", or "[\n]\n" for a shard without puzzles
+      size_t begin = text.find( '[' ) + 1, end = text.rfind( ']' );
+      std::string entries = end > begin ? text.substr( begin, end - begin ) : "";
+      while ( !entries.empty() && ( entries.back() == '\n' || entries.back() == ' ' ) )
+        entries.pop_back();
+      if ( entries.empty() )
+        continue;
+      merged += first ? entries : "," + entries;
+    } else {
+      size_t header = text.find( '\n' );
+      merged += first || header == std::string::npos ? text : text.substr( header + 1 );
+    }
+    first = false;
+  }
+  if ( asJson )
+    merged += "\n]\n";
+  std::ofstream out( gradePath );
+  out << merged;
+  if ( !out ) {
+    std::cerr << "failed to write " << gradePath << std::endl;
+    return false;
+  }
+  return true;
+}
+
+static void printTotals( const ShardJob &job, double seconds ) {
+  double totals[ sizeof( reportKeys ) / sizeof( reportKeys[ 0 ] ) ] = {};
+  for ( size_t shard = 0; shard < job.shards; shard++ ) {
+    std::ifstream log( shardPath( job, shard, ".log" ) );
+    std::string line;
+    while ( std::getline( log, line ) ) {
+      for ( size_t i = 0; i < sizeof( reportKeys ) / sizeof( reportKeys[ 0 ] ); i++ ) {
+        size_t length = std::strlen( reportKeys[ i ] );
+        if ( line.compare( 0, length, reportKeys[ i ] ) == 0 && line.size() > length && line[ length ] == ':' )
+          totals[ i ] += std::stod( line.substr( length + 1 ) );
+      }
+    }
+  }
+  std::cout << "shards:      " << job.shards << "\n";
+  for ( size_t i = 0; i < sizeof( reportKeys ) / sizeof( reportKeys[ 0 ] ); i++ ) {
+    std::cout << reportKeys[ i ] << ":" << std::string( 12 - std::strlen( reportKeys[ i ] ), ' ' )
+              << static_cast<uint64_t>( totals[ i ] ) << "\n";
+  }
+  std::cout << "seconds:     " << seconds << std::endl;
+}
+
+static int usage() {
+  std::cerr << "usage: sudoku shard <file> [--shards N] [--jobs N] [--dir path] [--output file] [--grade file]"
+               " [--threads N] [--pipeline name] [--time-limit ms] [--step-limit N] [--speculate N] [--lanes]"
+            << std::endl;
+  return 2;
+}
+
+int runShard( int argc, char **argv ) {
+  std::string input, outputPath, gradePath;
+  ShardJob job;
+  unsigned jobs = std::thread::hardware_concurrency();
+  bool threadsGiven = false;
+  for ( int i = 0; i < argc; i++ ) {
+    std::string arg = argv[ i ];
+    if ( arg == "--shards" && i + 1 < argc ) {
+      job.shards = std::stoull( argv[ ++i ] );
+    } else if ( arg == "--jobs" && i + 1 < argc ) {
+      jobs = std::stoul( argv[ ++i ] );
+    } else if ( arg == "--dir" && i + 1 < argc ) {
+      job.dir = argv[ ++i ];
+    } else if ( arg == "--output" && i + 1 < argc ) {
+      outputPath = argv[ ++i ];
+    } else if ( arg == "--grade" && i + 1 < argc ) {
+      gradePath = argv[ ++i ];
+    } else if ( ( arg == "--threads" || arg == "--pipeline" || arg == "--time-limit" || arg == "--step-limit" ||
+                  arg == "--speculate" ) &&
+                i + 1 < argc ) {
+      threadsGiven |= arg == "--threads";
+      job.batchArgs.push_back( arg );
+      job.batchArgs.push_back( argv[ ++i ] );
+    } else if ( arg == "--lanes" ) {
+      job.batchArgs.push_back( arg );
+    } else if ( arg.rfind( "--", 0 ) == 0 || !input.empty() ) {
+      return usage();
+    } else {
+      input = arg;
+    }
+  }
+  if ( input.empty() || job.shards == 0 )
+    return usage();
+  jobs = std::max( 1u, jobs );
+  // the processes are the parallelism, one thread each unless asked otherwise
+  if ( !threadsGiven ) {
+    job.batchArgs.push_back( "--threads" );
+    job.batchArgs.push_back( "1" );
+  }
+  if ( job.dir.empty() )
+    job.dir = input + ".shards";
+  if ( !gradePath.empty() )
+    job.gradeExtension = isJsonPath( gradePath ) ? ".json" : ".csv";
+
+  struct stat info;
+  if ( stat( input.c_str(), &info ) != 0 ) {
+    std::cerr << "failed to open " << input << std::endl;
+    return 1;
+  }
+  if ( mkdir( job.dir.c_str(), 0755 ) != 0 && errno != EEXIST ) {
+    std::cerr << "failed to create " << job.dir << ": " << std::strerror( errno ) << std::endl;
+    return 1;
+  }
+
+  // what the shards were made from and with: a restart only reuses them for the same job
+  std::string manifest = "input " + input + "\nbytes " + std::to_string( info.st_size ) + "\nmodified " +
+                         std::to_string( info.st_mtime ) + "\nshards " + std::to_string( job.shards ) + "\ngrades " +
+                         job.gradeExtension + "\nbatch";
+  for ( const std::string &arg : job.batchArgs ) {
+    manifest += " " + arg;
+  }
+  manifest += "\n";
+  std::string existing;
+  if ( readFile( job.dir + "/manifest", existing ) ) {
+    if ( existing != manifest ) {
+      std::cerr << job.dir << " holds shards of a different job (input, shard count or batch options changed); "
+                << "remove it or pick another --dir" << std::endl;
+      return 1;
+    }
+  } else if ( !prepareShards( input, job, manifest ) ) {
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  size_t failed = runShards( job, jobs );
+  double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+  if ( failed > 0 ) {
+    std::cerr << failed << " shards failed; run again to retry them, the rest are kept" << std::endl;
+    return 1;
+  }
+
+  if ( !outputPath.empty() && !mergeOutputs( job, outputPath ) )
+    return 1;
+  if ( !gradePath.empty() && !mergeGrades( job, gradePath ) )
+    return 1;
+  printTotals( job, seconds );
+  return 0;
+}
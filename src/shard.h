@@ -0,0 +1,9 @@
+#pragma once
+
+// sudoku shard <file> [--shards N] [--jobs N] [--dir path] [--output file] [--grade file]
+//              [--threads N] [--pipeline name] [--time-limit ms] [--step-limit N] [--speculate N] [--lanes]
+//
+// Splits the input into shards in dir and runs batch on each in its own process, jobs at a
+// time. A shard that finishes is checkpointed, so running the same command again after a
+// crash only redoes the shards that weren't; outputs are merged in input order at the end.
+int runShard( int argc, char **argv );
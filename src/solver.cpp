@@ -0,0 +1,351 @@
+#include "solver.h"
+#include "kernels.h"
+#include "pipeline.h"
+#include "search.h"
+
+// the cells of one row of a box, and of one column, as bits of box cell indices
+template <int N> constexpr uint32_t boxRowMask() { return ( 1u << N ) - 1; }
+template <int N> constexpr uint32_t boxColMask() {
+  uint32_t mask = 0;
+  for ( int i = 0; i < N; i++ ) {
+    mask |= 1u << ( i * N );
+  }
+  return mask;
+}
+
+template <int N>
+static void addPlacement( PlacementList<N> &list, uint64_t seen[], int cell, int num ) {
+  uint64_t bit = 1ull << ( cell & 63 );
+  if ( seen[ cell >> 6 ] & bit )
+    return;
+  seen[ cell >> 6 ] |= bit;
+  list.items[ list.count++ ] = { static_cast<typename BasicBoard<N>::Cell>( cell ), static_cast<uint8_t>( num ) };
+}
+
+// for one digit, the columns it can go in for each row and the rows it can go in for each column
+template <int N>
+static void linePositions( const BasicBoard<N> &board, uint32_t bit, uint32_t rowPositions[],
+                           uint32_t colPositions[] ) {
+  using B = BasicBoard<N>;
+  for ( int i = 0; i < B::GRID_SIZE; i++ ) {
+    rowPositions[ i ] = 0;
+    colPositions[ i ] = 0;
+  }
+  for ( int cell = 0; cell < B::CELL_COUNT; cell++ ) {
+    if ( board.candidates[ cell ] & bit ) {
+      rowPositions[ B::cellRow( cell ) ] |= 1u << B::cellCol( cell );
+      colPositions[ B::cellCol( cell ) ] |= 1u << B::cellRow( cell );
+    }
+  }
+}
+
+template <int N> void findAllNakedSingles( BasicBoard<N> &board, PlacementList<N> &nakedSingles ) {
+  nakedSingles.count = 0;
+  int cell;
+  while ( ( cell = popDirtyCell( board ) ) >= 0 ) {
+    uint32_t candidates = board.candidates[ cell ];
+    if ( board.values[ cell ] == 0 && candidates && !( candidates & ( candidates - 1 ) ) ) {
+      nakedSingles.items[ nakedSingles.count++ ] = { static_cast<typename BasicBoard<N>::Cell>( cell ),
+                                                     static_cast<uint8_t>( __builtin_ctz( candidates ) + 1 ) };
+    }
+  }
+}
+
+template <int N> void findAllHiddenSingles( BasicBoard<N> &board, PlacementList<N> &hiddenSingles ) {
+  using B = BasicBoard<N>;
+  uint64_t seen[ B::CELL_WORDS ] = {};
+  typename B::Mask once[ B::UNIT_COUNT ], twice[ B::UNIT_COUNT ];
+  typename B::UnitMask units = board.dirtyUnits;
+  board.dirtyUnits = 0;
+  hiddenSingles.count = 0;
+  countQueuedUnitCandidates( board, units, once, twice );
+
+  // rows, then columns, then boxes
+  while ( units ) {
+    int unit = lowestUnit( units );
+    units &= units - 1;
+    const auto *cells = boardTables<N>.unitCells[ unit ];
+    uint32_t singles = once[ unit ] & ~twice[ unit ];
+    while ( singles ) {
+      uint32_t bit = singles & -singles;
+      singles &= singles - 1;
+      for ( int i = 0; i < B::GRID_SIZE; i++ ) {
+        if ( board.candidates[ cells[ i ] ] & bit ) {
+          addPlacement( hiddenSingles, seen, cells[ i ], __builtin_ctz( bit ) + 1 );
+          break;
+        }
+      }
+    }
+  }
+}
+
+template <int N> bool applyPointingPairs( BasicBoard<N> &board ) {
+  using B = BasicBoard<N>;
+  bool changed = false;
+  for ( int box = 0; box < B::GRID_SIZE; box++ ) {
+    const auto *cells = boardTables<N>.unitCells[ B::boxUnit( box ) ];
+    for ( int num = 1; num <= B::GRID_SIZE; num++ ) {
+      uint32_t bit = digitBit( num );
+      uint32_t positions = 0;
+      for ( int i = 0; i < B::GRID_SIZE; i++ ) {
+        if ( board.candidates[ cells[ i ] ] & bit )
+          positions |= 1u << i;
+      }
+
+      int count = __builtin_popcount( positions );
+      if ( count < 2 || count > N )
+        continue;
+
+      int first = cells[ __builtin_ctz( positions ) ];
+      int boxIndex = __builtin_ctz( positions );
+      if ( !( positions & ~( boxRowMask<N>() << ( boxIndex / N * N ) ) ) ) {
+        int row = B::cellRow( first );
+        for ( int col = 0; col < B::GRID_SIZE; col++ ) {
+          int cell = row * B::GRID_SIZE + col;
+          if ( B::cellBox( cell ) != box )
+            changed |= removeCandidate( board, num, cell );
+        }
+      } else if ( !( positions & ~( boxColMask<N>() << ( boxIndex % N ) ) ) ) {
+        int col = B::cellCol( first );
+        for ( int row = 0; row < B::GRID_SIZE; row++ ) {
+          int cell = row * B::GRID_SIZE + col;
+          if ( B::cellBox( cell ) != box )
+            changed |= removeCandidate( board, num, cell );
+        }
+      }
+    }
+  }
+
+  return changed;
+}
+
+template <int N> bool reduceBoxLine( BasicBoard<N> &board ) {
+  using B = BasicBoard<N>;
+  bool changed = false;
+  uint32_t rowPositions[ B::GRID_SIZE ], colPositions[ B::GRID_SIZE ];
+  for ( int num = 1; num <= B::GRID_SIZE; num++ ) {
+    linePositions( board, digitBit( num ), rowPositions, colPositions );
+
+    // a digit confined to one box within a line can't go anywhere else in that box
+    for ( int line = 0; line < B::GRID_SIZE; line++ ) {
+      for ( int orientation = 0; orientation < 2; orientation++ ) {
+        uint32_t positions = orientation == 0 ? rowPositions[ line ] : colPositions[ line ];
+        int count = __builtin_popcount( positions );
+        if ( count < 2 || count > N )
+          continue;
+
+        int band = __builtin_ctz( positions ) / N;
+        if ( positions & ~( boxRowMask<N>() << ( band * N ) ) )
+          continue;
+
+        int box = orientation == 0 ? ( line / N ) * N + band : band * N + line / N;
+        for ( int cell : boardTables<N>.unitCells[ B::boxUnit( box ) ] ) {
+          int cellLine = orientation == 0 ? B::cellRow( cell ) : B::cellCol( cell );
+          if ( cellLine != line )
+            changed |= removeCandidate( board, num, cell );
+        }
+      }
+    }
+  }
+
+  return changed;
+}
+
+// One digit's positions seen from one orientation: base[ line ] is the cover lines the digit
+// can go in on that base line, cover[ line ] the same positions the other way round. Rows
+// are the base lines when byRow is set, columns otherwise.
+template <int N> struct FishLines {
+  BasicBoard<N> &board;
+  int num;
+  bool byRow;
+  uint32_t *base;
+  uint32_t *cover;
+
+  int cell( int baseLine, int coverLine ) const {
+    return byRow ? baseLine * BasicBoard<N>::GRID_SIZE + coverLine : coverLine * BasicBoard<N>::GRID_SIZE + baseLine;
+  }
+};
+
+// the lines of one band or stack
+template <int N> constexpr uint32_t chunkMask( int chunk ) { return boxRowMask<N>() << ( chunk * N ); }
+
+// removes the digit from every cover line in covers, on the base lines in targets
+template <int N> static bool eliminateFromCovers( FishLines<N> &lines, uint32_t covers, uint32_t targets ) {
+  bool changed = false;
+  while ( covers ) {
+    int coverLine = __builtin_ctz( covers );
+    covers &= covers - 1;
+    uint32_t victims = lines.cover[ coverLine ] & targets;
+    while ( victims ) {
+      int baseLine = __builtin_ctz( victims );
+      victims &= victims - 1;
+      changed |= removeCandidate( lines.board, lines.num, lines.cell( baseLine, coverLine ) );
+      lines.base[ baseLine ] &= ~( 1u << coverLine );
+      lines.cover[ coverLine ] &= ~( 1u << baseLine );
+    }
+  }
+  return changed;
+}
+
+// A fish whose base lines have positions (the fins) outside its covers, all in the fin box.
+// Either a fin holds the digit, which clears it from the rest of that box, or the base lines
+// form a plain fish on the covers; the cells both cases clear are the covers' cells in the
+// fin box outside the base lines. covered is what the covers have to include, the positions
+// outside the fin box; the rest of the covers can be any of the fin box's lines.
+template <int N>
+static bool eliminateFinnedFish( FishLines<N> &lines, int size, int finBox, uint32_t bases, uint32_t positions,
+                                 uint32_t covered ) {
+  uint32_t finLines = chunkMask<N>( finBox % N );
+  uint32_t optional = positions & ~covered;
+  int missing = size - __builtin_popcount( covered );
+  bool changed = false;
+  for ( uint32_t picked = optional;; picked = ( picked - 1 ) & optional ) {
+    if ( __builtin_popcount( picked ) == missing )
+      changed |= eliminateFromCovers( lines, ( covered | picked ) & finLines, chunkMask<N>( finBox / N ) & ~bases );
+    if ( !picked )
+      break;
+  }
+  return changed;
+}
+
+// Extends the base set one line at a time in increasing line order and checks it once it
+// has size lines. A plain fish (finBox < 0) needs exactly size cover lines. A finned one
+// has more, but only size of them once the fin box's own cells are left out, so both are
+// pruned the same way. finBox counts base-line chunks first: box / N is the chunk of base
+// lines through the box and box % N the chunk of cover lines.
+template <int N>
+static bool findFish( FishLines<N> &lines, int size, int finBox, int first, int depth, uint32_t bases,
+                      uint32_t positions, uint32_t covered ) {
+  using B = BasicBoard<N>;
+  if ( depth == size ) {
+    if ( finBox < 0 )
+      return __builtin_popcount( positions ) == size && eliminateFromCovers( lines, positions, ~bases );
+    return __builtin_popcount( positions ) > size &&
+           eliminateFinnedFish( lines, size, finBox, bases, positions, covered );
+  }
+
+  bool changed = false;
+  for ( int line = first; line <= B::GRID_SIZE - size + depth; line++ ) {
+    uint32_t linePositions = lines.base[ line ];
+    // a line down to one position is a hidden single, not a base line
+    if ( __builtin_popcount( linePositions ) < 2 )
+      continue;
+    uint32_t lineCovered = linePositions;
+    if ( finBox >= 0 && line / N == finBox / N )
+      lineCovered &= ~chunkMask<N>( finBox % N );
+    uint32_t combined = covered | lineCovered;
+    if ( __builtin_popcount( combined ) <= size )
+      changed |= findFish( lines, size, finBox, line + 1, depth + 1, bases | 1u << line, positions | linePositions,
+                           combined );
+  }
+  return changed;
+}
+
+// a fin box only clears anything if the digit is in it on at least two lines each way: one
+// of them holds the fins, the other the cells to clear
+template <int N> static bool finBoxUseful( const FishLines<N> &lines, int finBox ) {
+  uint32_t rows = 0, cols = 0;
+  for ( uint32_t rest = chunkMask<N>( finBox / N ); rest; rest &= rest - 1 ) {
+    int line = __builtin_ctz( rest );
+    uint32_t inBox = lines.base[ line ] & chunkMask<N>( finBox % N );
+    rows |= ( inBox != 0 ) << line;
+    cols |= inBox;
+  }
+  return __builtin_popcount( rows ) >= 2 && __builtin_popcount( cols ) >= 2;
+}
+
+template <int N> bool eliminateFish( BasicBoard<N> &board, int size, bool finned ) {
+  using B = BasicBoard<N>;
+  bool changed = false;
+  uint32_t rowPositions[ B::GRID_SIZE ], colPositions[ B::GRID_SIZE ];
+  for ( int num = 1; num <= B::GRID_SIZE; num++ ) {
+    linePositions( board, digitBit( num ), rowPositions, colPositions );
+    FishLines<N> byRow = { board, num, true, rowPositions, colPositions };
+    FishLines<N> byCol = { board, num, false, colPositions, rowPositions };
+    for ( int finBox = finned ? 0 : -1; finBox < ( finned ? B::GRID_SIZE : 0 ); finBox++ ) {
+      for ( FishLines<N> *lines : { &byRow, &byCol } ) {
+        if ( finBox < 0 || finBoxUseful( *lines, finBox ) )
+          changed |= findFish( *lines, size, finBox, 0, 0, 0, 0, 0 );
+      }
+    }
+  }
+  return changed;
+}
+
+template <int N> bool xWing( BasicBoard<N> &board ) { return eliminateFish( board, 2, false ); }
+template <int N> bool swordfish( BasicBoard<N> &board ) { return eliminateFish( board, 3, false ); }
+template <int N> bool jellyfish( BasicBoard<N> &board ) { return eliminateFish( board, 4, false ); }
+
+// smallest first, so the step reports the simplest fish that made progress
+template <int N> bool finnedFish( BasicBoard<N> &board ) {
+  for ( int size = 2; size <= 3; size++ ) {
+    if ( eliminateFish( board, size, true ) )
+      return true;
+  }
+  return false;
+}
+
+template <int N> Technique solveStep( BasicBoard<N> &board, SolveStats *stats ) {
+  return HumanPipeline::step( board, stats );
+}
+
+// step until solved, until a step leaves the board untouched or until the budget runs out
+template <int N>
+bool solveLogically( BasicBoard<N> &board, SolveStats *stats, SolveTrace *trace, SolveBudget *budget ) {
+  return HumanPipeline::solve( board, stats, trace, budget );
+}
+
+template <int N>
+bool searchFallback( BasicBoard<N> &board, SolveStats *stats, SolveTrace *trace, SolveBudget *budget,
+                     ThreadPool *pool ) {
+  int empty = 0;
+  if ( stats ) {
+    for ( uint8_t value : board.values ) {
+      empty += value == 0;
+    }
+  }
+  TechniqueProbe probe( stats, board );
+  probe.begin();
+  bool solved = pool && N > 3 ? parallelSearchSolve( board, *pool, budget ) : searchSolve( board, budget );
+  probe.end( SEARCH, solved, solved ? empty : 0 );
+  // a search cut short left the board as it was, so it isn't part of the partial trace
+  if ( trace && !( budget && budget->isExhausted() ) )
+    trace->push_back( SEARCH );
+  return solved;
+}
+
+template <int N> bool solve( BasicBoard<N> &board, SolveStats *stats, SolveTrace *trace, SolveBudget *budget ) {
+  return solveLogically( board, stats, trace, budget ) || searchFallback( board, stats, trace, budget );
+}
+
+template <int N>
+StopReason solveWithBudget( BasicBoard<N> &board, SolveBudget &budget, SolveStats *stats, SolveTrace *trace,
+                            ThreadPool *pool, int pipeline ) {
+  bool logical = withPipeline( pipeline, [ & ]( auto steps ) {
+    return decltype( steps )::solve( board, stats, trace, &budget );
+  } );
+  if ( logical ||
+       ( !budget.isExhausted() && searchFallback( board, stats, trace, &budget, pool ) ) )
+    return STOP_SOLVED;
+  return budget.isExhausted() ? budget.reason() : STOP_NO_SOLUTION;
+}
+
+#define INSTANTIATE_SOLVER( N )                                                                                        \
+  template void findAllNakedSingles( BasicBoard<N> &, PlacementList<N> & );                                            \
+  template void findAllHiddenSingles( BasicBoard<N> &, PlacementList<N> & );                                           \
+  template bool applyPointingPairs( BasicBoard<N> & );                                                                 \
+  template bool reduceBoxLine( BasicBoard<N> & );                                                                      \
+  template bool eliminateFish( BasicBoard<N> &, int, bool );                                                           \
+  template bool xWing( BasicBoard<N> & );                                                                              \
+  template bool swordfish( BasicBoard<N> & );                                                                          \
+  template bool jellyfish( BasicBoard<N> & );                                                                          \
+  template bool finnedFish( BasicBoard<N> & );                                                                         \
+  template Technique solveStep( BasicBoard<N> &, SolveStats * );                                                       \
+  template bool solveLogically( BasicBoard<N> &, SolveStats *, SolveTrace *, SolveBudget * );                          \
+  template bool searchFallback( BasicBoard<N> &, SolveStats *, SolveTrace *, SolveBudget *, ThreadPool * );            \
+  template bool solve( BasicBoard<N> &, SolveStats *, SolveTrace *, SolveBudget * );                                   \
+  template StopReason solveWithBudget( BasicBoard<N> &, SolveBudget &, SolveStats *, SolveTrace *, ThreadPool *, int );
+
+INSTANTIATE_SOLVER( 3 )
+INSTANTIATE_SOLVER( 4 )
+INSTANTIATE_SOLVER( 5 )
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "board.h"
+#include "budget.h"
+#include "stats.h"
+#include "technique.h"
+
+class ThreadPool;
+
+template <int N> struct Placement {
+  typename BasicBoard<N>::Cell cell;
+  uint8_t num;
+};
+
+// fixed capacity, a cell is never listed twice
+template <int N> struct PlacementList {
+  Placement<N> items[ BasicBoard<N>::CELL_COUNT ];
+  int count = 0;
+};
+
+// All of these are instantiated for box sizes 3, 4 and 5.
+
+// both only look at the cells / units queued on the board since their last call, and clear that queue
+template <int N> void findAllNakedSingles( BasicBoard<N> &board, PlacementList<N> &nakedSingles );
+template <int N> void findAllHiddenSingles( BasicBoard<N> &board, PlacementList<N> &hiddenSingles );
+template <int N> bool applyPointingPairs( BasicBoard<N> &board );
+template <int N> bool reduceBoxLine( BasicBoard<N> &board );
+// fish of size 2 (x-wing) to 4 (jellyfish) for every digit, rows as base lines and then
+// columns; finned also takes fins confined to one box. Applies every fish it finds and
+// reports whether any of them removed a candidate.
+template <int N> bool eliminateFish( BasicBoard<N> &board, int size, bool finned );
+template <int N> bool xWing( BasicBoard<N> &board );
+template <int N> bool swordfish( BasicBoard<N> &board );
+template <int N> bool jellyfish( BasicBoard<N> &board );
+// finned x-wing then finned swordfish, stopping at the first that makes progress; finned
+// jellyfish (eliminateFish( board, 4, true )) costs more than it finds, so it isn't tried
+template <int N> bool finnedFish( BasicBoard<N> &board );
+
+// applies the first technique in the cascade that reports progress and returns it
+template <int N> Technique solveStep( BasicBoard<N> &board, SolveStats *stats = nullptr );
+// The budget, when given, is charged a step per logical step and per search node; once it
+// runs out these return false with the board as far as they got.
+template <int N>
+bool solveLogically( BasicBoard<N> &board, SolveStats *stats = nullptr, SolveTrace *trace = nullptr,
+                     SolveBudget *budget = nullptr );
+// searchSolve, counted and traced as the SEARCH technique; given a pool, 16x16 and 25x25
+// boards are searched with parallelSearchSolve on it instead
+template <int N>
+bool searchFallback( BasicBoard<N> &board, SolveStats *stats = nullptr, SolveTrace *trace = nullptr,
+                     SolveBudget *budget = nullptr, ThreadPool *pool = nullptr );
+// logical techniques first, search once they stall
+template <int N>
+bool solve( BasicBoard<N> &board, SolveStats *stats = nullptr, SolveTrace *trace = nullptr,
+            SolveBudget *budget = nullptr );
+// solve with an answer to why it stopped. Short of STOP_SOLVED the board is the partial
+// result: the values placed and the candidates left, with trace holding the techniques
+// that got it there and budget.steps() what it cost. A search cut short leaves the board
+// as the logical techniques left it. pipeline is the PipelinePreset stepped before search.
+template <int N>
+StopReason solveWithBudget( BasicBoard<N> &board, SolveBudget &budget, SolveStats *stats = nullptr,
+                            SolveTrace *trace = nullptr, ThreadPool *pool = nullptr, int pipeline = HUMAN_PIPELINE );
@@ -0,0 +1,121 @@
+#include "stats.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int openCounter( uint64_t config, int groupFd ) {
+  perf_event_attr attr = {};
+  attr.size = sizeof( attr );
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = groupFd < 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return syscall( SYS_perf_event_open, &attr, 0, -1, groupFd, 0 );
+}
+
+PerfCounters::~PerfCounters() {
+  if ( branchFd >= 0 )
+    close( branchFd );
+  if ( groupFd >= 0 )
+    close( groupFd );
+}
+
+bool PerfCounters::open() {
+  if ( groupFd >= 0 )
+    return true;
+  groupFd = openCounter( PERF_COUNT_HW_CACHE_MISSES, -1 );
+  if ( groupFd < 0 )
+    return false;
+  branchFd = openCounter( PERF_COUNT_HW_BRANCH_MISSES, groupFd );
+  if ( branchFd < 0 ) {
+    close( groupFd );
+    groupFd = -1;
+    return false;
+  }
+  ioctl( groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+  ioctl( groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+  return true;
+}
+
+void PerfCounters::read( uint64_t &cacheMisses, uint64_t &branchMisses ) {
+  // PERF_FORMAT_GROUP: count of events, then one value per event in creation order
+  uint64_t values[ 3 ] = { 0, 0, 0 };
+  if ( groupFd < 0 || ::read( groupFd, values, sizeof( values ) ) != sizeof( values ) ) {
+    cacheMisses = branchMisses = 0;
+    return;
+  }
+  cacheMisses = values[ 1 ];
+  branchMisses = values[ 2 ];
+}
+#else
+PerfCounters::~PerfCounters() {}
+bool PerfCounters::open() { return false; }
+void PerfCounters::read( uint64_t &cacheMisses, uint64_t &branchMisses ) { cacheMisses = branchMisses = 0; }
+#endif
+
+void SolveStats::merge( const SolveStats &other ) {
+  for ( int i = 0; i < TECHNIQUE_COUNT; i++ ) {
+    TechniqueStats &counters = techniques[ i ];
+    const TechniqueStats &add = other.techniques[ i ];
+    counters.calls += add.calls;
+    counters.hits += add.hits;
+    counters.placements += add.placements;
+    counters.eliminations += add.eliminations;
+    counters.cycles += add.cycles;
+    counters.cacheMisses += add.cacheMisses;
+    counters.branchMisses += add.branchMisses;
+  }
+}
+
+json SolveStats::toJson() const {
+  json result = json::object();
+  for ( int i = 0; i < TECHNIQUE_COUNT; i++ ) {
+    const TechniqueStats &counters = techniques[ i ];
+    result[ techniqueName( i ) ] = {
+        { "calls",         counters.calls        },
+        { "hits",          counters.hits         },
+        { "placements",    counters.placements   },
+        { "eliminations",  counters.eliminations },
+        { "cycles",        counters.cycles       },
+        { "cache_misses",  counters.cacheMisses  },
+        { "branch_misses", counters.branchMisses },
+    };
+  }
+  return result;
+}
+
+// Per step, roughly how much harder each technique is to spot than a naked single. Search
+// is charged once per puzzle but outweighs any number of logical steps that precede it.
+static const uint32_t techniqueWeights[ TECHNIQUE_COUNT ] = {
+    1,    // naked singles
+    2,    // hidden singles
+    10,   // pointing pairs
+    12,   // box/line reduction
+    15,   // naked subsets
+    20,   // hidden subsets
+    30,   // x-wing
+    35,   // xy-wing
+    40,   // swordfish
+    45,   // xyz-wing
+    60,   // jellyfish
+    70,   // finned fish
+    500,  // search
+};
+
+Grade gradeTrace( const SolveTrace &trace ) {
+  Grade grade = {};
+  grade.hardest = NO_TECHNIQUE;
+  for ( uint8_t technique : trace ) {
+    grade.counts[ technique ]++;
+    grade.score += techniqueWeights[ technique ];
+    if ( grade.hardest == NO_TECHNIQUE || technique > grade.hardest )
+      grade.hardest = technique;
+  }
+  grade.difficulty = difficultyOf( grade.hardest );
+  return grade;
+}
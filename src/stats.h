@@ -0,0 +1,122 @@
+#pragma once
+
+#include "board.h"
+#include "technique.h"
+#include <vector>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+struct TechniqueStats {
+  uint64_t calls;
+  uint64_t hits;
+  uint64_t placements;
+  uint64_t eliminations;  // candidates removed, including those a placement clears
+  uint64_t cycles;
+  uint64_t cacheMisses;
+  uint64_t branchMisses;
+};
+
+// Hardware counters for the calling thread through perf_event_open, Linux only.
+class PerfCounters {
+public:
+  PerfCounters() = default;
+  ~PerfCounters();
+
+  PerfCounters( const PerfCounters & ) = delete;
+  PerfCounters &operator=( const PerfCounters & ) = delete;
+
+  // counts the calling thread from here on, false when the kernel won't allow it
+  bool open();
+  bool isOpen() const { return groupFd >= 0; }
+  void read( uint64_t &cacheMisses, uint64_t &branchMisses );
+
+private:
+  int groupFd = -1;
+  int branchFd = -1;
+};
+
+// Per-technique counters. Solvers take a SolveStats pointer and skip all of the
+// bookkeeping when it is null.
+struct SolveStats {
+  TechniqueStats techniques[ TECHNIQUE_COUNT ] = {};
+  // not owned; set to also count cache misses and branch mispredicts
+  PerfCounters *perf = nullptr;
+
+  void merge( const SolveStats &other );
+  json toJson() const;
+};
+
+// technique applied at each step of one solve
+using SolveTrace = std::vector<uint8_t>;
+
+// What one solve's trace says about the puzzle: how often each technique fired, the
+// hardest one needed, and a score that weighs every step by how hard its technique is.
+struct Grade {
+  uint32_t counts[ TECHNIQUE_COUNT ];
+  int hardest;  // NO_TECHNIQUE for a board that was already solved
+  uint32_t score;
+  int difficulty;
+};
+
+Grade gradeTrace( const SolveTrace &trace );
+
+inline uint64_t readCycles() {
+#if defined( __x86_64__ ) || defined( __i386__ )
+  return __rdtsc();
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+template <int N> inline uint64_t countCandidates( const BasicBoard<N> &board ) {
+  uint64_t count = 0;
+  for ( uint32_t candidates : board.candidates ) {
+    count += __builtin_popcount( candidates );
+  }
+  return count;
+}
+
+// Measures one technique call: begin() before, end() after. Does nothing without stats.
+template <int N> class TechniqueProbe {
+public:
+  TechniqueProbe( SolveStats *stats, const BasicBoard<N> &board ) : stats( stats ), board( board ) {}
+
+  void begin() {
+    if ( !stats )
+      return;
+    candidates = countCandidates( board );
+    if ( stats->perf )
+      stats->perf->read( cacheMisses, branchMisses );
+    start = readCycles();
+  }
+
+  void end( Technique technique, bool hit, int placements ) {
+    if ( !stats )
+      return;
+    uint64_t cycles = readCycles() - start;
+    TechniqueStats &counters = stats->techniques[ technique ];
+    counters.calls++;
+    counters.hits += hit;
+    counters.placements += placements;
+    counters.eliminations += candidates - countCandidates( board );
+    counters.cycles += cycles;
+    if ( stats->perf ) {
+      uint64_t cacheMissesAfter, branchMissesAfter;
+      stats->perf->read( cacheMissesAfter, branchMissesAfter );
+      counters.cacheMisses += cacheMissesAfter - cacheMisses;
+      counters.branchMisses += branchMissesAfter - branchMisses;
+    }
+  }
+
+private:
+  SolveStats *stats;
+  const BasicBoard<N> &board;
+  uint64_t candidates = 0;
+  uint64_t start = 0;
+  uint64_t cacheMisses = 0;
+  uint64_t branchMisses = 0;
+};
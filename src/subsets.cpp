@@ -0,0 +1,181 @@
+#include "subsets.h"
+
+template <int N> static bool sees( int a, int b ) {
+  return ( boardTables<N>.cellUnitBits[ a ] & boardTables<N>.cellUnitBits[ b ] ) != 0;
+}
+
+template <int N> static bool removeDigits( BasicBoard<N> &board, uint32_t digits, int cell ) {
+  bool changed = false;
+  for ( digits &= board.candidates[ cell ]; digits; digits &= digits - 1 ) {
+    changed |= removeCandidate( board, __builtin_ctz( digits ) + 1, cell );
+  }
+  return changed;
+}
+
+// Extends the subset one cell at a time in increasing unit order, pruning as soon as the
+// cells hold more than size digits between them. open is the unit's empty cells.
+template <int N>
+static bool findNakedSubset( BasicBoard<N> &board, const typename BasicBoard<N>::Cell *cells, uint32_t open,
+                             int size, int first, int depth, uint32_t chosen, uint32_t digits ) {
+  using B = BasicBoard<N>;
+  if ( depth == size ) {
+    if ( __builtin_popcount( digits ) != size )
+      return false;
+    bool changed = false;
+    for ( uint32_t rest = open & ~chosen; rest; rest &= rest - 1 ) {
+      changed |= removeDigits( board, digits, cells[ __builtin_ctz( rest ) ] );
+    }
+    return changed;
+  }
+
+  bool changed = false;
+  for ( int i = first; i <= B::GRID_SIZE - size + depth; i++ ) {
+    uint32_t candidates = board.candidates[ cells[ i ] ];
+    // a cell down to one candidate is a naked single, not part of a subset
+    if ( !( open >> i & 1 ) || __builtin_popcount( candidates ) < 2 )
+      continue;
+    uint32_t combined = digits | candidates;
+    if ( __builtin_popcount( combined ) <= size )
+      changed |= findNakedSubset( board, cells, open, size, i + 1, depth + 1, chosen | 1u << i, combined );
+  }
+  return changed;
+}
+
+// the same over digits, where positions[ d ] is the cells of the unit digit d + 1 can go in
+template <int N>
+static bool findHiddenSubset( BasicBoard<N> &board, const typename BasicBoard<N>::Cell *cells,
+                              const uint32_t positions[], int size, int first, int depth, uint32_t digits,
+                              uint32_t chosen ) {
+  using B = BasicBoard<N>;
+  if ( depth == size ) {
+    if ( __builtin_popcount( chosen ) != size )
+      return false;
+    bool changed = false;
+    for ( uint32_t rest = chosen; rest; rest &= rest - 1 ) {
+      changed |= removeDigits( board, B::ALL_CANDIDATES & ~digits, cells[ __builtin_ctz( rest ) ] );
+    }
+    return changed;
+  }
+
+  bool changed = false;
+  for ( int d = first; d <= B::GRID_SIZE - size + depth; d++ ) {
+    // a digit down to one cell is a hidden single
+    if ( __builtin_popcount( positions[ d ] ) < 2 )
+      continue;
+    uint32_t combined = chosen | positions[ d ];
+    if ( __builtin_popcount( combined ) <= size )
+      changed |= findHiddenSubset( board, cells, positions, size, d + 1, depth + 1, digits | 1u << d, combined );
+  }
+  return changed;
+}
+
+template <int N> static uint32_t emptyCells( const BasicBoard<N> &board, const typename BasicBoard<N>::Cell *cells ) {
+  uint32_t open = 0;
+  for ( int i = 0; i < BasicBoard<N>::GRID_SIZE; i++ ) {
+    open |= uint32_t( board.values[ cells[ i ] ] == 0 ) << i;
+  }
+  return open;
+}
+
+template <int N> bool eliminateNakedSubsets( BasicBoard<N> &board, int size ) {
+  bool changed = false;
+  for ( const auto &cells : boardTables<N>.unitCells ) {
+    uint32_t open = emptyCells( board, cells );
+    // with only size cells left the subset is the whole rest of the unit
+    if ( __builtin_popcount( open ) > size )
+      changed |= findNakedSubset( board, cells, open, size, 0, 0, 0, 0 );
+  }
+  return changed;
+}
+
+template <int N> bool eliminateHiddenSubsets( BasicBoard<N> &board, int size ) {
+  using B = BasicBoard<N>;
+  bool changed = false;
+  for ( const auto &cells : boardTables<N>.unitCells ) {
+    uint32_t open = emptyCells( board, cells );
+    if ( __builtin_popcount( open ) <= size )
+      continue;
+    uint32_t positions[ B::GRID_SIZE ] = {};
+    for ( uint32_t rest = open; rest; rest &= rest - 1 ) {
+      int i = __builtin_ctz( rest );
+      for ( uint32_t digits = board.candidates[ cells[ i ] ]; digits; digits &= digits - 1 ) {
+        positions[ __builtin_ctz( digits ) ] |= 1u << i;
+      }
+    }
+    changed |= findHiddenSubset( board, cells, positions, size, 0, 0, 0, 0 );
+  }
+  return changed;
+}
+
+template <int N> bool nakedSubsets( BasicBoard<N> &board ) {
+  for ( int size = 2; size <= 4; size++ ) {
+    if ( eliminateNakedSubsets( board, size ) )
+      return true;
+  }
+  return false;
+}
+
+template <int N> bool hiddenSubsets( BasicBoard<N> &board ) {
+  for ( int size = 2; size <= 4; size++ ) {
+    if ( eliminateHiddenSubsets( board, size ) )
+      return true;
+  }
+  return false;
+}
+
+// the pivot's peers that could be its pincers: bivalue, and sharing exactly one digit with
+// an xy pivot or both digits with an xyz one
+template <int N>
+static int findPincers( const BasicBoard<N> &board, int pivot, int shared, typename BasicBoard<N>::Cell pincers[] ) {
+  uint32_t pivotCandidates = board.candidates[ pivot ];
+  int count = 0;
+  for ( int peer : boardTables<N>.peers[ pivot ] ) {
+    uint32_t candidates = board.candidates[ peer ];
+    if ( board.values[ peer ] == 0 && __builtin_popcount( candidates ) == 2 &&
+         __builtin_popcount( candidates & pivotCandidates ) == shared )
+      pincers[ count++ ] = peer;
+  }
+  return count;
+}
+
+template <int N> static bool wings( BasicBoard<N> &board, int pivotSize ) {
+  using B = BasicBoard<N>;
+  bool changed = false;
+  typename B::Cell pincers[ B::PEER_COUNT ];
+  for ( int pivot = 0; pivot < B::CELL_COUNT; pivot++ ) {
+    uint32_t pivotCandidates = board.candidates[ pivot ];
+    if ( board.values[ pivot ] || __builtin_popcount( pivotCandidates ) != pivotSize )
+      continue;
+    int count = findPincers( board, pivot, pivotSize - 1, pincers );
+    for ( int i = 0; i < count; i++ ) {
+      for ( int j = i + 1; j < count; j++ ) {
+        uint32_t first = board.candidates[ pincers[ i ] ], second = board.candidates[ pincers[ j ] ];
+        // the pincers together have to hold each of the pivot's other digits once, plus z
+        uint32_t z = first & second;
+        if ( __builtin_popcount( z ) != 1 || ( ( first | second ) & ~z ) != ( pivotCandidates & ~z ) )
+          continue;
+        for ( int cell : boardTables<N>.peers[ pincers[ i ] ] ) {
+          if ( cell != pivot && cell != pincers[ j ] && sees<N>( cell, pincers[ j ] ) &&
+               ( pivotSize == 2 || sees<N>( cell, pivot ) ) )
+            changed |= removeCandidate( board, __builtin_ctz( z ) + 1, cell );
+        }
+      }
+    }
+  }
+  return changed;
+}
+
+template <int N> bool xyWing( BasicBoard<N> &board ) { return wings( board, 2 ); }
+template <int N> bool xyzWing( BasicBoard<N> &board ) { return wings( board, 3 ); }
+
+#define INSTANTIATE_SUBSETS( N )                                                                                       \
+  template bool eliminateNakedSubsets( BasicBoard<N> &, int );                                                         \
+  template bool eliminateHiddenSubsets( BasicBoard<N> &, int );                                                        \
+  template bool nakedSubsets( BasicBoard<N> & );                                                                       \
+  template bool hiddenSubsets( BasicBoard<N> & );                                                                      \
+  template bool xyWing( BasicBoard<N> & );                                                                             \
+  template bool xyzWing( BasicBoard<N> & );
+
+INSTANTIATE_SUBSETS( 3 )
+INSTANTIATE_SUBSETS( 4 )
+INSTANTIATE_SUBSETS( 5 )
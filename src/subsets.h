@@ -0,0 +1,23 @@
+#pragma once
+
+#include "board.h"
+
+// Subset and wing techniques. All of them work off bitmasks: a unit's cells as bits of
+// their index within the unit, a cell's candidates as digit bits, and cellUnitBits for
+// whether two cells see each other. Each applies everything it finds and reports whether
+// it removed a candidate. Instantiated for box sizes 3, 4 and 5.
+
+// size cells of a unit holding only size digits between them: no other cell of the unit
+// can take those digits
+template <int N> bool eliminateNakedSubsets( BasicBoard<N> &board, int size );
+// size digits of a unit that fit only in size cells: those cells can't take anything else
+template <int N> bool eliminateHiddenSubsets( BasicBoard<N> &board, int size );
+// pairs, then triples, then quads, stopping at the first size that makes progress
+template <int N> bool nakedSubsets( BasicBoard<N> &board );
+template <int N> bool hiddenSubsets( BasicBoard<N> &board );
+
+// a bivalue pivot xy seeing bivalue pincers xz and yz: whichever the pivot takes, one of
+// the pincers is z, so z goes from every cell seeing both pincers
+template <int N> bool xyWing( BasicBoard<N> &board );
+// the same with a pivot xyz, which can be z itself, so the cells also have to see the pivot
+template <int N> bool xyzWing( BasicBoard<N> &board );
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// the step cascade in order, search last
+enum Technique : uint8_t {
+  NAKED_SINGLES,
+  HIDDEN_SINGLES,
+  POINTING_PAIRS,
+  BOX_LINE_REDUCTION,
+  NAKED_SUBSETS,
+  HIDDEN_SUBSETS,
+  X_WING,
+  XY_WING,
+  SWORDFISH,
+  XYZ_WING,
+  JELLYFISH,
+  FINNED_FISH,
+  SEARCH,
+  TECHNIQUE_COUNT,
+  NO_TECHNIQUE = TECHNIQUE_COUNT
+};
+
+inline const char *techniqueName( int technique ) {
+  static const char *names[ TECHNIQUE_COUNT + 1 ] = {
+      "naked_singles", "hidden_singles", "pointing_pairs", "box_line_reduction", "naked_subsets", "hidden_subsets",
+      "x_wing",        "xy_wing",        "swordfish",      "xyz_wing",           "jellyfish",     "finned_fish",
+      "search",        "none",
+  };
+  return names[ technique ];
+}
+
+// one character per technique for compact traces
+inline char techniqueCode( int technique ) { return "NHPBnhXYSZJFD-"[ technique ]; }
+
+#define DIFFICULTY_COUNT 4
+
+// difficulty of a puzzle by the hardest technique its solve needed: singles are easy,
+// intersections and subsets medium, fish and wings hard and anything that needs search expert
+inline int difficultyOf( int hardest ) {
+  if ( hardest == NO_TECHNIQUE || hardest <= HIDDEN_SINGLES )
+    return 0;
+  if ( hardest <= HIDDEN_SUBSETS )
+    return 1;
+  return hardest == SEARCH ? 3 : 2;
+}
+
+inline const char *difficultyName( int difficulty ) {
+  static const char *names[ DIFFICULTY_COUNT ] = { "easy", "medium", "hard", "expert" };
+  return names[ difficulty ];
+}
+
+// the step cascades pipeline.h builds in, from fewest techniques to all of them, and the
+// whole ladder reordered at runtime by scheduler.h
+enum PipelinePreset { SINGLES_PIPELINE, BASIC_PIPELINE, HUMAN_PIPELINE, ADAPTIVE_PIPELINE, PIPELINE_COUNT };
+
+inline const char *pipelineName( int preset ) {
+  static const char *names[ PIPELINE_COUNT ] = { "singles", "basic", "human", "adaptive" };
+  return names[ preset ];
+}
+
+// PIPELINE_COUNT for a name that isn't a preset
+inline int parsePipeline( const char *name ) {
+  for ( int preset = 0; preset < PIPELINE_COUNT; preset++ ) {
+    if ( std::strcmp( name, pipelineName( preset ) ) == 0 )
+      return preset;
+  }
+  return PIPELINE_COUNT;
+}
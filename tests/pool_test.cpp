@@ -0,0 +1,41 @@
+#include "pool.h"
+#include <atomic>
+#include <iostream>
+
+// A task of pool A that submits to a smaller pool B must not use its index in A as one in
+// B, or it lands past the end of B's workers (batch --threads 8 --speculate 2).
+static bool nestedSubmit() {
+  ThreadPool outer( 8 ), inner( 2 );
+  std::atomic<int> ran { 0 }, misplaced { 0 };
+  outer.parallelFor( 64, 1, [ & ]( size_t, size_t, unsigned ) {
+    misplaced += inner.currentWorker() != -1;
+    inner.submit( [ & ] { ran++; } );
+  } );
+  inner.wait();
+  return ran == 64 && misplaced == 0;
+}
+
+// from inside the pool a task goes on the submitting worker's own deque
+static bool ownSubmit() {
+  ThreadPool pool( 4 );
+  std::atomic<int> ran { 0 }, outside { 0 };
+  pool.parallelFor( 16, 1, [ & ]( size_t, size_t, unsigned worker ) {
+    outside += pool.currentWorker() != static_cast<int>( worker );
+    pool.submit( [ & ] { ran++; } );
+  } );
+  pool.wait();
+  return ran == 16 && outside == 0 && pool.currentWorker() == -1;
+}
+
+int main() {
+  int failed = 0;
+  if ( !nestedSubmit() ) {
+    std::cerr << "nestedSubmit failed" << std::endl;
+    failed++;
+  }
+  if ( !ownSubmit() ) {
+    std::cerr << "ownSubmit failed" << std::endl;
+    failed++;
+  }
+  return failed != 0;
+}